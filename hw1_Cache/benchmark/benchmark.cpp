@@ -0,0 +1,262 @@
+#include <cmath>
+#include <vector>
+#include <random>
+#include <cstddef>
+
+#include <benchmark/benchmark.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "utils.hpp"
+#include "lirs_cache.hpp"
+#include "arena_allocator.hpp"
+
+const int SEED = 42;
+
+namespace {
+
+double get_page(int key) {
+    return std::sin(key);
+}
+
+// Zipf-запросы к n_unique ключам, перемешанные со сканами из уникальных ключей.
+// scan_percent - доля запросов, приходящихся на сканы
+std::vector<int> make_scan_mixed_trace(size_t n_requests, int n_unique, int scan_percent) {
+    std::mt19937 rng(SEED);
+
+    std::vector<double> weights(n_unique);
+    for (int i = 0; i < n_unique; ++i) {
+        weights[i] = 1.0 / std::pow(i + 1, 0.9);
+    }
+    std::discrete_distribution<int> zipf(weights.begin(), weights.end());
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    const int scan_len = n_unique / 10;
+    int next_scan_key  = n_unique;
+
+    std::vector<int> trace;
+    trace.reserve(n_requests);
+    while (trace.size() < n_requests) {
+        if (percent(rng) < scan_percent) {
+            for (int i = 0; i < scan_len && trace.size() < n_requests; ++i) {
+                trace.push_back(next_scan_key++);
+            }
+        } else {
+            for (int i = 0; i < scan_len && trace.size() < n_requests; ++i) {
+                trace.push_back(zipf(rng));
+            }
+        }
+    }
+    return trace;
+}
+
+// Постоянный равномерный набор из hot_set ключей, перемешанный со скользящим
+// окном шириной window; на окно приходится две трети запросов
+std::vector<int> make_sliding_mixed_trace(size_t n_requests, int hot_set, int window) {
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int> hot(0, hot_set - 1);
+    std::uniform_int_distribution<int> offset(0, window - 1);
+    std::uniform_int_distribution<int> pick(0, 2);
+
+    std::vector<int> trace;
+    trace.reserve(n_requests);
+    for (size_t i = 0; i < n_requests; ++i) {
+        if (pick(rng) == 0) {
+            trace.push_back(hot(rng));
+        } else {
+            trace.push_back(hot_set + static_cast<int>(i / 10) + offset(rng));
+        }
+    }
+    return trace;
+}
+
+void run_lirs(benchmark::State& state, const std::vector<int>& trace, caches::LirsOptions options) {
+    const size_t cache_size = static_cast<size_t>(state.range(0));
+
+    size_t n_hits = 0;
+    for (auto _ : state) {
+        caches::LirsCache<double> cache(cache_size, options);
+        n_hits = utils::count_hits(cache, trace, get_page);
+        benchmark::DoNotOptimize(n_hits);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * trace.size());
+    state.counters["hit_ratio"] = static_cast<double>(n_hits) / trace.size();
+}
+
+// Счетчик промахов dTLB на чтение через perf_event_open.
+// Если счетчик недоступен (нет прав, контейнер), valid() == false
+class DtlbMissCounter {
+public:
+    DtlbMissCounter() {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.type   = PERF_TYPE_HW_CACHE;
+        attr.size   = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB
+                    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    DtlbMissCounter(const DtlbMissCounter&) = delete;
+    DtlbMissCounter& operator=(const DtlbMissCounter&) = delete;
+
+    ~DtlbMissCounter() {
+#if defined(__linux__)
+        if (valid()) { close(fd_); }
+#endif
+    }
+
+    bool valid() const { return fd_ >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        if (valid()) { ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0); }
+#endif
+    }
+
+    void stop() {
+#if defined(__linux__)
+        if (valid()) { ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0); }
+#endif
+    }
+
+    long long value() const {
+        long long count = 0;
+#if defined(__linux__)
+        if (valid() && read(fd_, &count, sizeof(count)) != sizeof(count)) { count = 0; }
+#endif
+        return count;
+    }
+
+private:
+    int fd_{-1};
+};
+
+// Равномерные запросы к вдвое большему числу ключей, чем помещается в кэш:
+// метаданные LIRS разбросаны по памяти и каждый lookup - случайный доступ
+template <typename Cache>
+void run_large_lookup(benchmark::State& state, Cache& cache) {
+    const size_t cache_size = static_cast<size_t>(state.range(0));
+
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(cache_size * 2));
+    std::vector<int> trace(1'000'000);
+    for (int& key : trace) { key = dist(rng); }
+
+    // прогрев: кэш и стек заполнены
+    for (size_t i = 0; i < cache_size * 3; ++i) {
+        cache.lookup_update(dist(rng), get_page);
+    }
+
+    DtlbMissCounter dtlb;
+    dtlb.start();
+    for (auto _ : state) {
+        size_t n_hits = utils::count_hits(cache, trace, get_page);
+        benchmark::DoNotOptimize(n_hits);
+    }
+    dtlb.stop();
+
+    const auto n_lookups = int64_t(state.iterations()) * static_cast<int64_t>(trace.size());
+    state.SetItemsProcessed(n_lookups);
+    // kIsRate | kInvert - секунды на поиск; консольный вывод сам подбирает приставку (us, ns)
+    state.counters["time_per_lookup"] = benchmark::Counter(
+        static_cast<double>(n_lookups), benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    if (dtlb.valid()) {
+        state.counters["dtlb_miss_per_lookup"] = static_cast<double>(dtlb.value()) / n_lookups;
+    }
+}
+
+} // namespace
+
+// ======================================================
+// 1️⃣ Benchmark: LIRS — скан-смешанный поток запросов
+// ======================================================
+static void BM_LirsScanMixed(benchmark::State& state) {
+    const auto trace = make_scan_mixed_trace(200'000, 20'000, static_cast<int>(state.range(1)));
+    run_lirs(state, trace, caches::LirsOptions{});
+}
+
+BENCHMARK(BM_LirsScanMixed)
+    ->ArgsProduct({{500, 2'000}, {0, 20, 50}})
+    ->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 2️⃣ Benchmark: LIRS + TinyLFU admission — тот же поток
+// ======================================================
+static void BM_LirsAdmissionScanMixed(benchmark::State& state) {
+    const auto trace = make_scan_mixed_trace(200'000, 20'000, static_cast<int>(state.range(1)));
+    run_lirs(state, trace, caches::LirsOptions{.admission = true});
+}
+
+BENCHMARK(BM_LirsAdmissionScanMixed)
+    ->ArgsProduct({{500, 2'000}, {0, 20, 50}})
+    ->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 3️⃣ Benchmark: LIRS — постоянный набор + скользящее окно
+// ======================================================
+static void BM_LirsSlidingMixed(benchmark::State& state) {
+    const auto trace = make_sliding_mixed_trace(600'000, state.range(0) / 2, state.range(0) * 6 / 10);
+    run_lirs(state, trace, caches::LirsOptions{});
+}
+
+BENCHMARK(BM_LirsSlidingMixed)
+    ->Arg(100)->Arg(1'000)->Arg(10'000)
+    ->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 4️⃣ Benchmark: LIRS с адаптивным разбиением — тот же поток
+// ======================================================
+static void BM_LirsAdaptiveSlidingMixed(benchmark::State& state) {
+    const auto trace = make_sliding_mixed_trace(600'000, state.range(0) / 2, state.range(0) * 6 / 10);
+    run_lirs(state, trace, caches::LirsOptions{.adaptive = true});
+}
+
+BENCHMARK(BM_LirsAdaptiveSlidingMixed)
+    ->Arg(100)->Arg(1'000)->Arg(10'000)
+    ->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 5️⃣ Benchmark: LIRS на миллионах записей — std::allocator
+// ======================================================
+static void BM_LirsLargeStdAlloc(benchmark::State& state) {
+    caches::LirsCache<double> cache(static_cast<size_t>(state.range(0)));
+    run_large_lookup(state, cache);
+}
+
+BENCHMARK(BM_LirsLargeStdAlloc)
+    ->Arg(1'000'000)->Arg(4'000'000)
+    ->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 6️⃣ Benchmark: LIRS на миллионах записей — huge page арена
+// ======================================================
+static void BM_LirsLargeHugePageArena(benchmark::State& state) {
+    caches::HugePageArena arena;
+    caches::LirsCache<double, int, caches::ArenaAllocator<int>> cache(
+        static_cast<size_t>(state.range(0)), caches::LirsOptions{}, caches::ArenaAllocator<int>(arena));
+    run_large_lookup(state, cache);
+}
+
+BENCHMARK(BM_LirsLargeHugePageArena)
+    ->Arg(1'000'000)->Arg(4'000'000)
+    ->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+BENCHMARK_MAIN();
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <new>
+#include <bit>
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace caches {
+
+// Арена для метаданных кэша. Память берется у ОС крупными кусками (mmap),
+// выровненными на 2 MiB и помеченными MADV_HUGEPAGE, так что узлы списков и
+// хеш-таблиц попадают на небольшое число huge pages и меньше нагружают TLB.
+// Мелкие блоки (до 512 байт) раздаются бампом и переиспользуются через free list
+// по классам размеров с шагом 16 байт. Средние (массивы бакетов, выровненные
+// типы) - степени двойки от 1 KiB до 2 MiB, выровненные на свой размер, берутся
+// из тех же кусков и тоже переиспользуются. Отдельное отображение получают
+// только блоки от 2 MiB, они сразу отдаются ОС при освобождении.
+// Арена не потокобезопасна - как и сами кэши.
+class HugePageArena {
+public:
+    static constexpr size_t huge_page_size = size_t{2} << 20;
+
+    explicit HugePageArena(size_t chunk_bytes = size_t{64} << 20)
+        : chunk_bytes_(round_up(chunk_bytes, huge_page_size)) {}
+
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+
+    ~HugePageArena() {
+        for (auto [base, bytes] : chunks_) {
+            unmap(base, bytes);
+        }
+    }
+
+    void* allocate(size_t bytes, size_t align) {
+        if (bytes >= huge_page_size) {
+            return map(round_up(bytes, huge_page_size));
+        }
+        if (bytes > max_small_size_ || align > granularity_) {
+            return allocate_medium(medium_class(bytes, align));
+        }
+
+        size_t cls = size_class(bytes);
+        if (void* block = pop(free_lists_[cls])) {
+            return block;
+        }
+
+        size_t size = (cls + 1) * granularity_;
+        if (static_cast<size_t>(end_ - cur_) < size) {
+            cur_ = new_chunk();
+            end_ = cur_ + chunk_bytes_;
+        }
+
+        void* res = cur_;
+        cur_ += size;
+        return res;
+    }
+
+    void deallocate(void* ptr, size_t bytes, size_t align) noexcept {
+        if (bytes >= huge_page_size) {
+            unmap(ptr, round_up(bytes, huge_page_size));
+        } else if (bytes > max_small_size_ || align > granularity_) {
+            push(medium_free_lists_[medium_class(bytes, align)], ptr);
+        } else {
+            push(free_lists_[size_class(bytes)], ptr);
+        }
+    }
+
+    // Арена по умолчанию для ArenaAllocator, созданных без явной арены
+    static HugePageArena& global() {
+        static HugePageArena arena;
+        return arena;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Chunk {
+        std::byte* base;
+        size_t bytes;
+    };
+
+    static constexpr size_t granularity_    = 16;
+    static constexpr size_t max_small_size_ = 512;
+
+    // Средние классы: 1 KiB, 2 KiB, ..., 2 MiB
+    static constexpr size_t min_medium_size_    = 1024;
+    static constexpr size_t medium_class_count_ =
+        std::bit_width(huge_page_size) - std::bit_width(min_medium_size_) + 1;
+
+    static constexpr size_t round_up(size_t x, size_t align) {
+        return (x + align - 1) / align * align;
+    }
+
+    static size_t size_class(size_t bytes) {
+        return (std::max<size_t>(bytes, 1) - 1) / granularity_;
+    }
+
+    static size_t medium_class(size_t bytes, size_t align) {
+        size_t size = std::bit_ceil(std::max({bytes, align, min_medium_size_}));
+        return std::bit_width(size) - std::bit_width(min_medium_size_);
+    }
+
+    static size_t medium_size(size_t cls) {
+        return min_medium_size_ << cls;
+    }
+
+    static void* pop(FreeBlock*& head) {
+        FreeBlock* block = head;
+        if (block != nullptr) { head = block->next; }
+        return block;
+    }
+
+    static void push(FreeBlock*& head, void* ptr) {
+        auto* block = static_cast<FreeBlock*>(ptr);
+        block->next = head;
+        head = block;
+    }
+
+    std::byte* new_chunk() {
+        chunks_.reserve(chunks_.size() + 1);
+        auto* base = static_cast<std::byte*>(map(chunk_bytes_));
+        chunks_.push_back({base, chunk_bytes_});
+        return base;
+    }
+
+    // Средние блоки режутся из отдельного куска по адресам, кратным своему размеру.
+    // Пропущенный при выравнивании промежуток не теряется, а раскладывается
+    // по free list меньших классов
+    void* allocate_medium(size_t cls) {
+        if (void* block = pop(medium_free_lists_[cls])) {
+            return block;
+        }
+
+        size_t size = medium_size(cls);
+        auto* aligned = reinterpret_cast<std::byte*>(round_up(reinterpret_cast<uintptr_t>(medium_cur_), size));
+        if (medium_cur_ == nullptr || aligned + size > medium_end_) {
+            release_medium_range(medium_cur_, medium_end_);
+            medium_cur_ = new_chunk();
+            medium_end_ = medium_cur_ + chunk_bytes_;
+            aligned = medium_cur_;
+        } else {
+            release_medium_range(medium_cur_, aligned);
+        }
+
+        medium_cur_ = aligned + size;
+        return aligned;
+    }
+
+    // Раскладывает [from, to) на выровненные блоки средних классов.
+    // Границы кратны min_medium_size_: все средние блоки кратны ему, а куски
+    // выровнены на huge page
+    void release_medium_range(std::byte* from, std::byte* to) noexcept {
+        while (from < to) {
+            auto addr = reinterpret_cast<uintptr_t>(from);
+            size_t piece = std::min<size_t>(addr & (~addr + 1), huge_page_size);
+            while (piece > static_cast<size_t>(to - from)) { piece >>= 1; }
+
+            push(medium_free_lists_[std::bit_width(piece) - std::bit_width(min_medium_size_)], from);
+            from += piece;
+        }
+    }
+
+#if defined(__linux__)
+    // mmap не гарантирует выравнивание на huge page, поэтому берем с запасом
+    // и обрезаем края
+    static void* map(size_t bytes) {
+        size_t reserve = bytes + huge_page_size;
+        void* raw = mmap(nullptr, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) { throw std::bad_alloc(); }
+
+        auto* base    = static_cast<std::byte*>(raw);
+        auto* aligned = reinterpret_cast<std::byte*>(
+            round_up(reinterpret_cast<uintptr_t>(base), huge_page_size));
+
+        if (aligned != base) {
+            munmap(base, aligned - base);
+        }
+        size_t tail = (base + reserve) - (aligned + bytes);
+        if (tail != 0) {
+            munmap(aligned + bytes, tail);
+        }
+
+#if defined(MADV_HUGEPAGE)
+        madvise(aligned, bytes, MADV_HUGEPAGE);
+#endif
+        return aligned;
+    }
+
+    static void unmap(void* ptr, size_t bytes) noexcept {
+        munmap(ptr, bytes);
+    }
+#else
+    static void* map(size_t bytes) {
+        void* ptr = std::aligned_alloc(huge_page_size, bytes);
+        if (ptr == nullptr) { throw std::bad_alloc(); }
+        return ptr;
+    }
+
+    static void unmap(void* ptr, size_t) noexcept {
+        std::free(ptr);
+    }
+#endif
+
+    size_t chunk_bytes_;
+    std::byte* cur_{nullptr};
+    std::byte* end_{nullptr};
+    std::vector<Chunk> chunks_;
+    std::array<FreeBlock*, max_small_size_ / granularity_> free_lists_{};
+
+    std::byte* medium_cur_{nullptr};
+    std::byte* medium_end_{nullptr};
+    std::array<FreeBlock*, medium_class_count_> medium_free_lists_{};
+};
+
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept : arena_(&HugePageArena::global()) {}
+
+    explicit ArenaAllocator(HugePageArena& arena) noexcept : arena_(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena_) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        arena_->deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ == other.arena_;
+    }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    HugePageArena* arena_;
+};
+
+} // namespace caches
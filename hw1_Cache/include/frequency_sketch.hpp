@@ -0,0 +1,146 @@
+#pragma once
+
+#include <bit>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+namespace caches {
+
+// Count-min sketch с 4-битными счетчиками (TinyLFU).
+// Счетчики одного ключа лежат в одном 64-байтном блоке (8 слов по 16 счетчиков),
+// поэтому increment/estimate трогают одну кэш-линию. Старение - деление всех
+// счетчиков пополам после sample_size_ инкрементов, делается пословно.
+template <typename KeyT, typename Alloc = std::allocator<uint64_t>>
+class FrequencySketch {
+public:
+    using WordAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<uint64_t>;
+
+    explicit FrequencySketch(size_t capacity, const Alloc& alloc = Alloc()) : table_(alloc) {
+        size_t n_words = std::bit_ceil(std::max<size_t>(capacity, block_words_));
+        table_.assign(n_words, 0);
+        block_mask_  = (n_words / block_words_) - 1;
+        sample_size_ = 10 * std::max<size_t>(capacity, 1);
+    }
+
+    void increment(const KeyT& key) {
+        uint64_t hash  = spread(std::hash<KeyT>{}(key));
+        size_t   block = (hash & block_mask_) * block_words_;
+        uint64_t counter_hash = rehash(hash);
+
+        bool added = false;
+        for (size_t i = 0; i < n_rows_; ++i) {
+            auto [word, shift] = locate(block, counter_hash, i);
+            if (((table_[word] >> shift) & counter_max_) != counter_max_) {
+                table_[word] += uint64_t{1} << shift;
+                added = true;
+            }
+        }
+
+        if (added && ++additions_ == sample_size_) {
+            reset();
+        }
+    }
+
+    unsigned estimate(const KeyT& key) const {
+        uint64_t hash  = spread(std::hash<KeyT>{}(key));
+        size_t   block = (hash & block_mask_) * block_words_;
+        uint64_t counter_hash = rehash(hash);
+
+        unsigned frequency = counter_max_;
+        for (size_t i = 0; i < n_rows_; ++i) {
+            auto [word, shift] = locate(block, counter_hash, i);
+            frequency = std::min(frequency, static_cast<unsigned>((table_[word] >> shift) & counter_max_));
+        }
+        return frequency;
+    }
+
+    // Ширина таблицы и период старения становятся такими же, как у sketch'а на capacity.
+    // Счетчики переносятся: при росте блок копируется во все блоки, куда теперь попадают
+    // его ключи, при сжатии сливаемые блоки берут максимум счетчиков, так что оценка
+    // ни одного ключа не уменьшается. Накопленные инкременты стареют по новому периоду
+    void resize(size_t capacity) {
+        size_t n_words = std::bit_ceil(std::max<size_t>(capacity, block_words_));
+        if (n_words != table_.size()) {
+            std::vector<uint64_t, WordAlloc> table(n_words, 0, table_.get_allocator());
+            size_t mask = (n_words / block_words_) - 1;
+            size_t from_blocks = std::max(mask, block_mask_) + 1;
+            for (size_t b = 0; b < from_blocks; ++b) {
+                size_t from = (b & block_mask_) * block_words_;
+                size_t to   = (b & mask) * block_words_;
+                for (size_t w = 0; w < block_words_; ++w) {
+                    table[to + w] = max_counters(table[to + w], table_[from + w]);
+                }
+            }
+            table_ = std::move(table);
+            block_mask_ = mask;
+        }
+
+        sample_size_ = 10 * std::max<size_t>(capacity, 1);
+        while (additions_ >= sample_size_) {
+            reset();
+        }
+    }
+
+    size_t sample_size() const {
+        return sample_size_;
+    }
+
+private:
+    struct Slot {
+        size_t   word;
+        unsigned shift;
+    };
+
+    // i-я строка sketch'а занимает слова block + 2i и block + 2i + 1
+    static Slot locate(size_t block, uint64_t counter_hash, size_t i) {
+        uint64_t h = counter_hash >> (i * 8);
+        size_t   word  = block + (i * 2) + (h & 1);
+        unsigned shift = static_cast<unsigned>((h >> 1) & 15) * 4;
+        return {word, shift};
+    }
+
+    // Максимум каждой пары соответствующих 4-битных счетчиков двух слов
+    static uint64_t max_counters(uint64_t a, uint64_t b) {
+        uint64_t res = 0;
+        for (unsigned shift = 0; shift < 64; shift += 4) {
+            res |= std::max((a >> shift) & counter_max_, (b >> shift) & counter_max_) << shift;
+        }
+        return res;
+    }
+
+    void reset() {
+        for (auto& word : table_) {
+            word = (word >> 1) & reset_mask_;
+        }
+        additions_ /= 2;
+    }
+
+    static uint64_t spread(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    static uint64_t rehash(uint64_t x) {
+        x *= 0x9e3779b97f4a7c15ULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    static constexpr size_t   block_words_ = 8;
+    static constexpr size_t   n_rows_      = 4;
+    static constexpr unsigned counter_max_ = 15;
+    static constexpr uint64_t reset_mask_  = 0x7777777777777777ULL;
+
+    std::vector<uint64_t, WordAlloc> table_;
+    size_t block_mask_{0};
+    size_t sample_size_{0};
+    size_t additions_{0};
+};
+
+} // namespace caches
@@ -1,13 +1,19 @@
 #pragma once
 
 #include <list>
+#include <memory>
 #include <utility>
 #include <cstddef>
 #include <cassert>
 #include <cstdint>
+#include <optional>
+#include <algorithm>
 #include <stdexcept>
+#include <unordered_set>
 #include <unordered_map>
 
+#include "frequency_sketch.hpp"
+
 namespace caches {
 
 enum class LirsType : std::uint8_t {
@@ -15,27 +21,52 @@ enum class LirsType : std::uint8_t {
     HIR = 1
 };
 
+struct LirsOptions {
+    bool admission{false};  // TinyLFU фильтр перед вытеснением холодной страницы
+    bool adaptive{false};   // подстройка sz_hot_/sz_cold_ по попаданиям в призраков
+};
+
 }
 
 namespace detail {
 
 using caches::LirsType;
 
-template <typename KeyT>
+template <typename Alloc, typename T>
+using rebind_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+template <typename KeyT, typename ValueT, typename Alloc>
+using UMap = std::unordered_map<KeyT, ValueT, std::hash<KeyT>, std::equal_to<KeyT>,
+                                rebind_alloc<Alloc, std::pair<const KeyT, ValueT>>>;
+
+template <typename KeyT, typename Alloc = std::allocator<KeyT>>
 class LirsStack {
 public:
     using Entry       = typename std::pair<KeyT, LirsType>; 
-    using StackList   = typename std::list<Entry>;
+    using StackList   = typename std::list<Entry, rebind_alloc<Alloc, Entry>>;
     using StackListIt = typename StackList::iterator;
-    using StackUMap   = typename std::unordered_map<KeyT, StackListIt>;
+    using StackUMap   = UMap<KeyT, StackListIt, Alloc>;
 
-    explicit LirsStack(size_t sz): sz_(sz) {}
+    explicit LirsStack(size_t sz, const Alloc& alloc = Alloc()): sz_(sz), stack_(alloc), stackHash_(alloc) {}
 
     void push(KeyT key, LirsType type = LirsType::HIR) {
-        if (size() == sz_) { handle_overflow(); }
+        if (size() >= sz_) { handle_overflow(); }
         push_entry(key, type);
     }
 
+    // Новая емкость; лишние записи снимаются по одной через shrink_step()
+    void resize(size_t sz) {
+        sz_ = sz;
+    }
+
+    bool over_capacity() const {
+        return size() > sz_;
+    }
+
+    void shrink_step() {
+        if (over_capacity()) { handle_overflow(); }
+    }
+
     void pop() {
         assert(size());
         erase_entry(stack_.back().first);
@@ -83,7 +114,9 @@ private:
         auto it = std::ranges::find_if(stack_.rbegin(), stack_.rend(), 
             [](auto x) { return x.second == LirsType::HIR; });
 
-        assert((it != stack_.rend()) && "The stack size is less than the LIRS part in the cache");
+        // После сжатия кэша LIR записей может быть больше новой емкости стека,
+        // пока горячая часть не уменьшится - тогда стек временно переполнен
+        if (it == stack_.rend()) { return; }
 
         stackHash_.erase(it->first);
         stack_.erase(std::next(it).base());
@@ -103,44 +136,124 @@ private:
     StackUMap stackHash_;
 };
 
+// Ограниченная FIFO история ключей, вытесненных из кэша
+template <typename KeyT, typename Alloc = std::allocator<KeyT>>
+class GhostList {
+public:
+    using GhostListT   = typename std::list<KeyT, rebind_alloc<Alloc, KeyT>>;
+    using GhostListIt  = typename GhostListT::iterator;
+    using GhostUMap    = UMap<KeyT, GhostListIt, Alloc>;
+
+    explicit GhostList(size_t sz, const Alloc& alloc = Alloc()): sz_(sz), ghosts_(alloc), ghostHash_(alloc) {}
+
+    void push(KeyT key) {
+        if (sz_ == 0) { return; }
+        if (ghosts_.size() == sz_) {
+            ghostHash_.erase(ghosts_.back());
+            ghosts_.pop_back();
+        }
+        ghosts_.push_front(key);
+        ghostHash_[key] = ghosts_.begin();
+    }
+
+    // Новая емкость; при сжатии забываются самые старые призраки
+    void resize(size_t sz) {
+        sz_ = sz;
+        while (ghosts_.size() > sz_) {
+            ghostHash_.erase(ghosts_.back());
+            ghosts_.pop_back();
+        }
+    }
+
+    bool erase(KeyT key) {
+        auto hash_it = ghostHash_.find(key);
+        if (hash_it == ghostHash_.end()) { return false; }
+
+        ghosts_.erase(hash_it->second);
+        ghostHash_.erase(hash_it);
+        return true;
+    }
+
+private:
+    size_t sz_;
+    GhostListT ghosts_;
+    GhostUMap ghostHash_;
+};
+
+// Состояние адаптивного режима: страницы, пониженные из горячей части,
+// и призраки тех из них, что были вытеснены без повторного обращения
+template <typename KeyT, typename Alloc = std::allocator<KeyT>>
+struct LirsAdaptiveState {
+    explicit LirsAdaptiveState(size_t sz, const Alloc& alloc = Alloc()): demoted(alloc), hotGhosts(sz, alloc) {}
+
+    std::unordered_set<KeyT, std::hash<KeyT>, std::equal_to<KeyT>, rebind_alloc<Alloc, KeyT>> demoted;
+    GhostList<KeyT, Alloc> hotGhosts;
+};
+
 } //namespace detail
 
 namespace caches {
 
-template <typename PageT, typename KeyT = int>
+// Alloc - аллокатор для всех метаданных кэша (списки, хеш-таблицы, sketch),
+// например ArenaAllocator из arena_allocator.hpp
+template <typename PageT, typename KeyT = int, typename Alloc = std::allocator<KeyT>>
 class LirsCache {
 public:
     using Entry         = typename std::pair<KeyT, PageT>; 
-    using CacheList     = typename std::list<Entry>;
+    using CacheList     = typename std::list<Entry, detail::rebind_alloc<Alloc, Entry>>;
     using CacheListIt   = typename CacheList::iterator;
-    using CacheUMap     = typename std::unordered_map<KeyT, CacheListIt>;
+    using CacheUMap     = detail::UMap<KeyT, CacheListIt, Alloc>;
 
-    explicit LirsCache(size_t sz) : lirsStack_(sz * stack_coeff_) {
+    explicit LirsCache(size_t sz, LirsOptions options = {}, const Alloc& alloc = Alloc())
+        : lirsStack_(sz * stack_coeff_, alloc),
+          hotCache_(alloc), hotHash_(alloc), coldCache_(alloc), coldHash_(alloc) {
         if (sz <= 1) {
             throw std::invalid_argument("Cache size must be greater than 1");
         }
-        sz_hot_ = static_cast<size_t>(sz * hot_part_);
-        sz_cold_ = sz - sz_hot_;
+        if (options.admission) {
+            admission_.emplace(sz, alloc);
+        }
+        if (options.adaptive) {
+            adaptive_.emplace(sz, alloc);
+        }
+        split_capacity(sz, hot_part_);
+    };
 
-        if (sz_cold_ == 0) {
-            ++sz_cold_;
-            --sz_hot_;
+    // Изменение размера без перестроения. Рост применяется сразу, при сжатии
+    // лишние страницы вытесняются в порядке LIRS (сначала холодные, затем
+    // пониженные LIR со дна стека) не более resize_step_ штук за запрос.
+    // Фильтр допуска и призраки адаптивного режима получают размеры, как у кэша,
+    // построенного на sz
+    void resize(size_t sz) {
+        if (sz <= 1) {
+            throw std::invalid_argument("Cache size must be greater than 1");
         }
 
-        if (sz_hot_ == 0) {
-            ++sz_hot_;
-            --sz_cold_;
+        double hot_part = hot_part_;
+        if (adaptive_) {
+            hot_part = static_cast<double>(sz_hot_) / static_cast<double>(capacity());
         }
-    };
+        split_capacity(sz, hot_part);
+
+        lirsStack_.resize(sz * stack_coeff_);
+        if (admission_) { admission_->resize(sz); }
+        if (adaptive_) { adaptive_->hotGhosts.resize(sz); }
+        shrinking_ = over_capacity();
+    }
 
     template <typename F>
     bool lookup_update(KeyT key, F get_page) {
+        if (shrinking_) { shrink_step(); }
+        if (admission_) { admission_->increment(key); }
+
         if (is_hit_hot(key)) {
             lirsStack_.push(key, LirsType::LIR);
             return true;
         }
         
         if (is_hit_cold(key)) {
+            if (adaptive_) { adaptive_->demoted.erase(key); }
+
             if (lirsStack_.contains(key)) {
                 lirsStack_.push(key, LirsType::LIR);
                 promote_to_hot(key);
@@ -151,11 +264,97 @@ public:
             return true;
         }
 
+        if (adaptive_) { adapt_on_miss(key); }
+
         handle_miss(key, get_page(key));
         return false;
     }
 
+    size_t size() const {
+        return hotCache_.size() + coldCache_.size();
+    }
+
+    size_t capacity() const {
+        return sz_hot_ + sz_cold_;
+    }
+
+    size_t hot_capacity() const {
+        return sz_hot_;
+    }
+
+    size_t cold_capacity() const {
+        return sz_cold_;
+    }
+
 private:
+    void split_capacity(size_t sz, double hot_part) {
+        sz_hot_ = static_cast<size_t>(static_cast<double>(sz) * hot_part);
+        sz_cold_ = sz - sz_hot_;
+
+        if (sz_cold_ == 0) {
+            ++sz_cold_;
+            --sz_hot_;
+        }
+
+        if (sz_hot_ == 0) {
+            ++sz_hot_;
+            --sz_cold_;
+        }
+    }
+
+    bool over_capacity() const {
+        return hotCache_.size() > sz_hot_ || coldCache_.size() > sz_cold_ || lirsStack_.over_capacity();
+    }
+
+    void shrink_step() {
+        for (size_t i = 0; i < resize_step_ && over_capacity(); ++i) {
+            if (coldCache_.size() > sz_cold_) {
+                evict_cold();
+            } else if (hotCache_.size() > sz_hot_) {
+                demote_lir_bottom();
+            } else {
+                lirsStack_.shrink_step();
+            }
+        }
+        shrinking_ = over_capacity();
+    }
+
+    // Аналог адаптации ARC: промах по нерезидентной HIR записи стека означает,
+    // что не хватило холодной части; промах по вытесненной пониженной LIR
+    // странице - что не хватило горячей
+    void adapt_on_miss(KeyT key) {
+        if (adaptive_->hotGhosts.erase(key)) {
+            grow_hot();
+        } else if (lirsStack_.contains(key)) {
+            grow_cold();
+        }
+    }
+
+    void grow_hot() {
+        if (sz_cold_ <= 1) { return; }
+        --sz_cold_;
+        ++sz_hot_;
+        if (coldCache_.size() > sz_cold_) {
+            evict_cold();
+        }
+    }
+
+    void grow_cold() {
+        if (sz_hot_ <= 1) { return; }
+        --sz_hot_;
+        ++sz_cold_;
+        if (hotCache_.size() > sz_hot_) {
+            demote_lir_bottom();
+        }
+    }
+
+    void demote_lir_bottom() {
+        KeyT victim_key = lirsStack_.bottom().first;
+        lirsStack_.pop();
+        move_from_to(hotCache_, hotHash_, coldCache_, coldHash_, victim_key);
+        if (adaptive_) { adaptive_->demoted.insert(victim_key); }
+    }
+
     void handle_miss(KeyT key, PageT page) {
         if (hotCache_.size() < sz_hot_) {
             lirsStack_.push(key, LirsType::LIR);
@@ -163,14 +362,15 @@ private:
             return;
         }
 
-        if (coldCache_.size() < sz_cold_) {
-            lirsStack_.push(key);
-            add_to_cache(coldCache_, coldHash_, key, page);
-            return;
+        if (coldCache_.size() >= sz_cold_) {
+            // Отвергнутый ключ не попадает и в стек: иначе при следующем промахе
+            // он числился бы недавно виденным и стал бы LIR в обход фильтра
+            if (!lirsStack_.contains(key) && !admit(key)) {
+                return;
+            }
+            evict_cold();
         }
 
-        evict_cold();
-        
         if (lirsStack_.contains(key)) {
             lirsStack_.push(key, LirsType::LIR);
             add_to_cache(coldCache_, coldHash_, key, page);
@@ -181,6 +381,12 @@ private:
         }
     }
 
+    // Новая страница вытесняет холодную, только если встречается чаще нее
+    bool admit(KeyT key) const {
+        if (!admission_) { return true; }
+        return admission_->estimate(key) > admission_->estimate(coldCache_.back().first);
+    }
+
     void move_to_front(CacheList& cache, CacheUMap& hash_map, KeyT key) {
         auto hash_it = hash_map.find(key);
         assert(hash_it != hash_map.end());
@@ -194,6 +400,7 @@ private:
         lirsStack_.pop();
 
         swap_cold_and_hot(key, victim_key);
+        if (adaptive_) { adaptive_->demoted.insert(victim_key); }
     }
 
     void add_to_cache(CacheList& cache, CacheUMap& hash_map, KeyT key, PageT page) {
@@ -204,7 +411,12 @@ private:
     }
 
     void evict_cold() {
-        coldHash_.erase(coldCache_.back().first);
+        KeyT victim_key = coldCache_.back().first;
+        if (adaptive_ && adaptive_->demoted.erase(victim_key)) {
+            adaptive_->hotGhosts.push(victim_key);
+        }
+
+        coldHash_.erase(victim_key);
         coldCache_.pop_back();
     }
 
@@ -233,17 +445,22 @@ private:
 
     double hot_part_{0.9};
     size_t stack_coeff_{3};
+    size_t resize_step_{2};
+    bool shrinking_{false};
 
     size_t sz_hot_;
     size_t sz_cold_;
 
-    detail::LirsStack<KeyT> lirsStack_;
+    detail::LirsStack<KeyT, Alloc> lirsStack_;
 
     CacheList hotCache_;
     CacheUMap hotHash_;
 
     CacheList coldCache_;
     CacheUMap coldHash_;
+
+    std::optional<FrequencySketch<KeyT, Alloc>> admission_;
+    std::optional<detail::LirsAdaptiveState<KeyT, Alloc>> adaptive_;
 };
 
 }  // namespace caches
@@ -3,7 +3,9 @@
 #include <cmath>
 #include <vector>
 #include <cstddef>
+#include <utility>
 #include <iostream>
+#include <stdexcept>
 
 namespace utils {
 
@@ -37,15 +39,93 @@ static void process_input(InputCacheData& ref_data) {
     }
 }
 
-template<typename Cache, typename F>
-static size_t count_hits(Cache& cache, const std::vector<int>& requests, F get_page) {
+// Модель стоимости запроса: попадание стоит hit_cost, промах - miss_cost
+// плюс передача страницы page_bytes по byte_cost за байт (единицы - на выбор, например нс)
+struct CostModel {
+    double hit_cost{0.0};
+    double miss_cost{0.0};
+    double byte_cost{0.0};
+    size_t page_bytes{0};
+
+    double hit_latency() const {
+        return hit_cost;
+    }
+
+    double miss_latency() const {
+        return miss_cost + byte_cost * static_cast<double>(page_bytes);
+    }
+};
+
+// Накопитель оценки времени. Стоимость запроса зависит только от исхода,
+// поэтому достаточно двух счетчиков: и сумма, и перцентили считаются по ним
+class LatencyAccumulator {
+public:
+    explicit LatencyAccumulator(CostModel model) : model_(model) {}
+
+    void record(bool hit) {
+        if (hit) {
+            ++n_hits_;
+        } else {
+            ++n_misses_;
+        }
+    }
+
+    size_t count() const {
+        return n_hits_ + n_misses_;
+    }
+
+    double total() const {
+        return static_cast<double>(n_hits_) * model_.hit_latency()
+             + static_cast<double>(n_misses_) * model_.miss_latency();
+    }
+
+    // Перцентиль по рангу (nearest-rank), p в [0, 100]
+    double percentile(double p) const {
+        if (p < 0.0 || p > 100.0) {
+            throw std::invalid_argument("Percentile must be in [0, 100]");
+        }
+        if (count() == 0) { return 0.0; }
+
+        double lat_low   = model_.hit_latency();
+        double lat_high  = model_.miss_latency();
+        size_t n_low     = n_hits_;
+        if (lat_high < lat_low) {
+            std::swap(lat_low, lat_high);
+            n_low = n_misses_;
+        }
+
+        auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(count())));
+        return (rank <= n_low) ? lat_low : lat_high;
+    }
+
+private:
+    CostModel model_;
+    size_t n_hits_{0};
+    size_t n_misses_{0};
+};
+
+// Накопитель-заглушка: без модели стоимости count_hits не делает лишней работы
+struct NoLatency {
+    void record(bool) {}
+};
+
+template<typename Cache, typename F, typename Latency>
+static size_t count_hits(Cache& cache, const std::vector<int>& requests, F get_page, Latency& latency) {
     size_t n_hits = 0;
     for (auto key : requests) {
-        if (cache.lookup_update(key, get_page)) {
+        bool hit = cache.lookup_update(key, get_page);
+        if (hit) {
             n_hits++;
-        }    
+        }
+        latency.record(hit);
     }    
     return n_hits;
 }
 
+template<typename Cache, typename F>
+static size_t count_hits(Cache& cache, const std::vector<int>& requests, F get_page) {
+    NoLatency latency;
+    return count_hits(cache, requests, get_page, latency);
+}
+
 } // namespace utils
@@ -16,6 +16,18 @@ int main(int argc, char** argv) {
         ->required()
         ->check(CLI::IsMember({"lirs", "belady"}));
 
+    caches::LirsOptions lirs_options;
+    app.add_flag("--admission", lirs_options.admission, "TinyLFU admission filter (lirs only)");
+    app.add_flag("--adaptive", lirs_options.adaptive, "Adaptive hot/cold partition (lirs only)");
+
+    utils::CostModel cost_model{.page_bytes = sizeof(double)};
+    bool with_cost = false;
+    app.add_flag("--cost", with_cost, "Print estimated time: total p50 p90 p99");
+    app.add_option("--hit-cost", cost_model.hit_cost, "Cost of a hit");
+    app.add_option("--miss-cost", cost_model.miss_cost, "Fixed cost of a miss");
+    app.add_option("--byte-cost", cost_model.byte_cost, "Cost per transferred byte on a miss");
+    app.add_option("--page-bytes", cost_model.page_bytes, "Page size in bytes");
+
     CLI11_PARSE(app, argc, argv);
 
     utils::InputCacheData data;
@@ -27,15 +39,30 @@ int main(int argc, char** argv) {
     }
 
     try {
+        utils::LatencyAccumulator latency(cost_model);
+        auto simulate = [&](auto& cache) {
+            if (with_cost) {
+                return utils::count_hits(cache, data.requests, utils::slow_get_page, latency);
+            }
+            return utils::count_hits(cache, data.requests, utils::slow_get_page);
+        };
+
         size_t n_hits = 0;
         if (cache_type == "lirs") {
-            caches::LirsCache<double> cache(data.size_cache);
-            n_hits = utils::count_hits(cache, data.requests, utils::slow_get_page);
+            caches::LirsCache<double> cache(data.size_cache, lirs_options);
+            n_hits = simulate(cache);
         } else if (cache_type == "belady") {
             caches::BeladyCache<double> cache(data.size_cache, data.requests);
-            n_hits = utils::count_hits(cache, data.requests, utils::slow_get_page);        
+            n_hits = simulate(cache);
         }
         std::cout << n_hits << std::endl;
+
+        if (with_cost) {
+            std::cout << latency.total()          << ' '
+                      << latency.percentile(50.0) << ' '
+                      << latency.percentile(90.0) << ' '
+                      << latency.percentile(99.0) << std::endl;
+        }
     } catch (const std::exception& e) {
         std::cerr << "Cache error: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,84 @@
+#include <list>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "lirs_cache.hpp"
+#include "arena_allocator.hpp"
+
+using namespace caches;
+
+namespace {
+double get_page(int key) {
+    return key * 0.5;
+}
+}
+
+TEST(ArenaAllocatorTest, ReusesFreedSmallBlocks) {
+    HugePageArena arena;
+    ArenaAllocator<long> alloc(arena);
+
+    long* first = alloc.allocate(1);
+    alloc.deallocate(first, 1);
+    long* second = alloc.allocate(1);
+
+    EXPECT_EQ(first, second);
+    alloc.deallocate(second, 1);
+}
+
+TEST(ArenaAllocatorTest, LargeBlocksAreHugePageAligned) {
+    HugePageArena arena;
+    ArenaAllocator<int> alloc(arena);
+
+    int* data = alloc.allocate(1 << 20);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(data) % HugePageArena::huge_page_size, 0u);
+    data[0] = 1;
+    data[(1 << 20) - 1] = 2;
+    alloc.deallocate(data, 1 << 20);
+}
+
+TEST(ArenaAllocatorTest, MediumBlocksShareChunks) {
+    HugePageArena arena;
+
+    // 1 KiB, затем 4 KiB: промежуток перед выровненным блоком уходит в free list
+    auto* first  = static_cast<std::byte*>(arena.allocate(1024, 8));
+    auto* second = static_cast<std::byte*>(arena.allocate(4096, 8));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(second) % 4096, 0u);
+    EXPECT_LT(second - first, static_cast<std::ptrdiff_t>(HugePageArena::huge_page_size));
+    EXPECT_EQ(arena.allocate(1000, 8), first + 1024);
+
+    arena.deallocate(second, 4096, 8);
+    EXPECT_EQ(arena.allocate(3000, 8), second);
+
+    // Выровненный мелкий блок - средний класс не меньше выравнивания
+    void* aligned = arena.allocate(32, 256);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 256, 0u);
+}
+
+TEST(ArenaAllocatorTest, WorksAsContainerAllocator) {
+    HugePageArena arena;
+    std::list<int, ArenaAllocator<int>> list{ArenaAllocator<int>(arena)};
+    std::vector<int, ArenaAllocator<int>> vec{ArenaAllocator<int>(arena)};
+    for (int i = 0; i < 10000; ++i) {
+        list.push_back(i);
+        vec.push_back(i);
+    }
+    EXPECT_EQ(list.size(), 10000);
+    EXPECT_EQ(vec.back(), 9999);
+}
+
+TEST(ArenaAllocatorTest, LirsCacheGivesSameHits) {
+    HugePageArena arena;
+    LirsCache<double> plain(16, LirsOptions{.admission = true, .adaptive = true});
+    LirsCache<double, int, ArenaAllocator<int>> arena_cache(
+        16, LirsOptions{.admission = true, .adaptive = true}, ArenaAllocator<int>(arena));
+
+    for (int i = 0; i < 5000; ++i) {
+        int key = (i * 7919) % 61;
+        EXPECT_EQ(plain.lookup_update(key, get_page), arena_cache.lookup_update(key, get_page));
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,71 @@
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "frequency_sketch.hpp"
+
+using namespace caches;
+
+TEST(FrequencySketchTest, EstimateGrowsWithIncrements) {
+    FrequencySketch<int> sketch(64);
+    EXPECT_EQ(sketch.estimate(7), 0u);
+
+    for (int i = 0; i < 5; ++i) {
+        sketch.increment(7);
+    }
+    EXPECT_GE(sketch.estimate(7), 5u);
+    EXPECT_LT(sketch.estimate(8), sketch.estimate(7));
+}
+
+TEST(FrequencySketchTest, CounterSaturatesAtFifteen) {
+    FrequencySketch<int> sketch(64);
+    for (int i = 0; i < 100; ++i) {
+        sketch.increment(1);
+    }
+    EXPECT_EQ(sketch.estimate(1), 15u);
+}
+
+TEST(FrequencySketchTest, AgingHalvesCounters) {
+    FrequencySketch<int> sketch(16);
+    for (int i = 0; i < 8; ++i) {
+        sketch.increment(-1);
+    }
+    unsigned before = sketch.estimate(-1);
+
+    // Добиваем до sample_size уникальными ключами, чтобы сработало старение
+    for (int key = 0; static_cast<size_t>(key) < sketch.sample_size(); ++key) {
+        sketch.increment(key);
+    }
+    EXPECT_LT(sketch.estimate(-1), before);
+}
+
+TEST(FrequencySketchTest, ResizeKeepsEstimatesAndMatchesNewCapacity) {
+    FrequencySketch<int> sketch(64);
+    for (int key = 0; key < 32; ++key) {
+        for (int i = 0; i < key % 8; ++i) {
+            sketch.increment(key);
+        }
+    }
+    std::vector<unsigned> before;
+    for (int key = 0; key < 32; ++key) {
+        before.push_back(sketch.estimate(key));
+    }
+
+    sketch.resize(4096);
+    EXPECT_EQ(sketch.sample_size(), FrequencySketch<int>(4096).sample_size());
+    for (int key = 0; key < 32; ++key) {
+        EXPECT_EQ(sketch.estimate(key), before[key]) << key;
+    }
+
+    // При сжатии сливаемые блоки берут максимум счетчиков, но 112 накопленных
+    // инкрементов больше нового периода старения (80), и счетчики делятся пополам
+    sketch.resize(8);
+    EXPECT_EQ(sketch.sample_size(), FrequencySketch<int>(8).sample_size());
+    for (int key = 0; key < 32; ++key) {
+        EXPECT_GE(sketch.estimate(key), before[key] / 2) << key;
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,6 @@
 #include <cmath>
 #include <string>
+#include <random>
 #include <fstream>
 #include <stdexcept>
 #include <filesystem>
@@ -37,6 +38,195 @@ TEST(LirsCacheTest, EvictionPolicy) {
     EXPECT_FALSE(cache.lookup_update(1, get_page));
 }
 
+TEST(LirsCacheTest, AdmissionProtectsFrequentPagesFromScan) {
+    // 1..9 занимают горячую часть, 50 живет в холодной, а скан 1000+ пытается ее вытеснить
+    std::vector<int> requests;
+    for (int round = 0; round < 50; ++round) {
+        for (int key = 1; key <= 9; ++key) {
+            requests.push_back(key);
+        }
+        requests.push_back(50);
+        for (int key = 0; key < 5; ++key) {
+            requests.push_back(1000 + round * 5 + key);
+        }
+    }
+
+    LirsCache<double> plain(10);
+    LirsCache<double> filtered(10, LirsOptions{.admission = true});
+
+    size_t plain_hits    = count_hits(plain, requests, get_page);
+    size_t filtered_hits = count_hits(filtered, requests, get_page);
+
+    EXPECT_GT(filtered_hits, plain_hits);
+}
+
+TEST(LirsCacheTest, AdmissionRejectedPageIsStillMissed) {
+    LirsCache<int> cache(2, LirsOptions{.admission = true});
+    EXPECT_FALSE(cache.lookup_update(1, get_page));
+    EXPECT_FALSE(cache.lookup_update(2, get_page));
+    EXPECT_TRUE( cache.lookup_update(2, get_page));
+    // 3 встречается реже 2 и не вытесняет ее из холодной части
+    EXPECT_FALSE(cache.lookup_update(3, get_page));
+    EXPECT_TRUE( cache.lookup_update(2, get_page));
+}
+
+TEST(LirsCacheTest, AdmissionRepeatedScanDoesNotReachHotPart) {
+    LirsCache<double> cache(10, LirsOptions{.admission = true});
+    for (int round = 0; round < 20; ++round) {
+        for (int key = 1; key <= 10; ++key) {
+            cache.lookup_update(key, get_page);
+        }
+    }
+
+    // Повторный скан: каждый ключ встречается дважды, но реже рабочего набора
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int key = 1000; key < 1020; ++key) {
+            EXPECT_FALSE(cache.lookup_update(key, get_page));
+        }
+    }
+
+    for (int key = 1; key <= 10; ++key) {
+        EXPECT_TRUE(cache.lookup_update(key, get_page)) << key;
+    }
+}
+
+TEST(LirsCacheTest, AdaptiveGrowsColdPartForSlidingWindow) {
+    // Постоянный набор 0..49 вперемешку со скользящим окном из 60 ключей
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> hot(0, 49);
+    std::uniform_int_distribution<int> window(0, 59);
+    std::uniform_int_distribution<int> pick(0, 2);
+
+    std::vector<int> requests;
+    for (int i = 0; i < 60000; ++i) {
+        if (pick(rng) == 0) {
+            requests.push_back(hot(rng));
+        } else {
+            requests.push_back(100000 + i / 10 + window(rng));
+        }
+    }
+
+    LirsCache<double> fixed(100);
+    LirsCache<double> adaptive(100, LirsOptions{.adaptive = true});
+
+    size_t fixed_hits    = count_hits(fixed, requests, get_page);
+    size_t adaptive_hits = count_hits(adaptive, requests, get_page);
+
+    EXPECT_GT(adaptive_hits, fixed_hits);
+    EXPECT_GT(adaptive.cold_capacity(), fixed.cold_capacity());
+    EXPECT_EQ(adaptive.hot_capacity() + adaptive.cold_capacity(), 100);
+}
+
+TEST(LirsCacheTest, AdaptiveKeepsBothPartsNonEmpty) {
+    LirsCache<int> cache(4, LirsOptions{.adaptive = true});
+    for (int round = 0; round < 100; ++round) {
+        for (int key = 0; key < 16; ++key) {
+            cache.lookup_update(key, get_page);
+        }
+    }
+    EXPECT_GE(cache.hot_capacity(), 1);
+    EXPECT_GE(cache.cold_capacity(), 1);
+    EXPECT_EQ(cache.hot_capacity() + cache.cold_capacity(), 4);
+}
+
+TEST(LirsCacheTest, ResizeGrowKeepsContents) {
+    LirsCache<int> cache(2);
+    EXPECT_FALSE(cache.lookup_update(1, get_page));
+    EXPECT_FALSE(cache.lookup_update(2, get_page));
+
+    cache.resize(4);
+    EXPECT_EQ(cache.capacity(), 4);
+
+    EXPECT_FALSE(cache.lookup_update(3, get_page));
+    EXPECT_FALSE(cache.lookup_update(4, get_page));
+    EXPECT_TRUE( cache.lookup_update(1, get_page));
+    EXPECT_TRUE( cache.lookup_update(2, get_page));
+    EXPECT_EQ(cache.size(), 4);
+}
+
+TEST(LirsCacheTest, ResizeShrinkIsAmortized) {
+    LirsCache<double> cache(100);
+    for (int key = 0; key < 100; ++key) {
+        cache.lookup_update(key, get_page);
+    }
+    EXPECT_EQ(cache.size(), 100);
+
+    cache.resize(10);
+    EXPECT_EQ(cache.capacity(), 10);
+    // Сам вызов ничего не вытесняет
+    EXPECT_EQ(cache.size(), 100);
+
+    // Каждый запрос снимает не больше двух лишних страниц
+    size_t prev_size = cache.size();
+    for (int i = 0; i < 200; ++i) {
+        cache.lookup_update(i % 7, get_page);
+        EXPECT_GE(cache.size() + 2, prev_size);
+        prev_size = cache.size();
+    }
+    EXPECT_LE(cache.size(), 10);
+
+    // Часто используемые страницы пережили сжатие
+    for (int key = 0; key < 7; ++key) {
+        EXPECT_TRUE(cache.lookup_update(key, get_page));
+    }
+}
+
+// Фильтр допуска и призраки после роста ведут себя как у кэша, сразу построенного
+// на новом размере: те же попадания и та же подстройка частей на одной трассе
+TEST(LirsCacheTest, ResizeGrowMatchesFreshCacheWithAdmissionAndAdaptive) {
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> hot(0, 149);
+    std::uniform_int_distribution<int> window(0, 119);
+    std::uniform_int_distribution<int> pick(0, 2);
+
+    std::vector<int> requests;
+    for (int i = 0; i < 60000; ++i) {
+        if (pick(rng) == 0) {
+            requests.push_back(hot(rng));
+        } else {
+            requests.push_back(100000 + i / 10 + window(rng));
+        }
+    }
+
+    LirsOptions options{.admission = true, .adaptive = true};
+    LirsCache<double> grown(10, options);
+    grown.resize(200);
+    LirsCache<double> fresh(200, options);
+
+    size_t mismatches = 0;
+    for (int key : requests) {
+        if (grown.lookup_update(key, get_page) != fresh.lookup_update(key, get_page)) {
+            ++mismatches;
+        }
+    }
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_EQ(grown.hot_capacity(), fresh.hot_capacity());
+}
+
+TEST(LirsCacheTest, ResizeRejectsTooSmallSize) {
+    LirsCache<int> cache(4);
+    EXPECT_THROW(cache.resize(1), std::invalid_argument);
+}
+
+TEST(LatencyAccumulatorTest, TotalAndPercentiles) {
+    CostModel model{.hit_cost = 1.0, .miss_cost = 100.0, .byte_cost = 0.5, .page_bytes = 8};
+    LatencyAccumulator latency(model);
+
+    LirsCache<double> cache(2);
+    const std::vector<int> requests = {1, 1, 1, 1, 1, 1, 1, 1, 1, 2};
+    size_t n_hits = count_hits(cache, requests, get_page, latency);
+
+    // промахи: 1 и 2, каждый стоит 100 + 0.5 * 8
+    EXPECT_EQ(n_hits, 8);
+    EXPECT_EQ(latency.count(), requests.size());
+    EXPECT_DOUBLE_EQ(latency.total(), 8 * 1.0 + 2 * 104.0);
+    EXPECT_DOUBLE_EQ(latency.percentile(50.0), 1.0);
+    EXPECT_DOUBLE_EQ(latency.percentile(80.0), 1.0);
+    EXPECT_DOUBLE_EQ(latency.percentile(90.0), 104.0);
+    EXPECT_DOUBLE_EQ(latency.percentile(100.0), 104.0);
+    EXPECT_THROW(latency.percentile(101.0), std::invalid_argument);
+}
+
 // чтение входных данных по ссылке
 void read_input_cache_data(const std::string& filename, InputCacheData& data) {
     std::ifstream fin(filename);
@@ -1,5 +1,7 @@
 #include <map>
+#include <string>
 #include <vector>
+#include <sstream>
 #include <random>
 #include <iterator>
 #include <algorithm>
@@ -7,6 +9,11 @@
 #include <benchmark/benchmark.h>
 
 #include "tree.hpp"
+#include "compact_tree.hpp"
+#include "versioned_tree.hpp"
+#include "interval_tree.hpp"
+#include "range_query.hpp"
+#include "fast_io.hpp"
 
 const int SEED = 42;
 
@@ -138,5 +145,889 @@ static void BM_TreeRangeQuery(benchmark::State& state) {
 BENCHMARK(BM_TreeRangeQuery)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
 
 
+// ======================================================
+// 5️⃣ Benchmark: ThreadedBinaryTree — count_range по размерам поддеревьев
+// ======================================================
+static void BM_TreeRangeCount(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const int Q = 100;
+
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int> dist(0, N * 10);
+
+    myds::ThreadedBinaryTree<int, int> tree;
+    for (int i = 0; i < N; ++i)
+        tree.insert(dist(rng), i);
+
+    std::vector<std::pair<int, int>> queries(Q);
+    for (auto& [a, b] : queries) {
+        a = dist(rng);
+        b = dist(rng);
+        if (a > b) std::swap(a, b);
+    }
+
+    for (auto _ : state) {
+        size_t total = 0;
+        for (const auto& [a, b] : queries) {
+            total += tree.count_range(a, b);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * Q);
+}
+
+BENCHMARK(BM_TreeRangeCount)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+
+
+// ======================================================
+// 6️⃣ Benchmark: ThreadedBinaryTree на std::allocator — вставка
+//    (база для сравнения с пулом узлов в BM_TreeInsert)
+// ======================================================
+static void BM_TreeInsertStdAlloc(benchmark::State& state) {
+    using Tree = myds::ThreadedBinaryTree<int, int, std::less<int>,
+                                          myds::NoAggregate, myds::AvlBalance,
+                                          std::allocator<std::pair<const int, int>>>;
+
+    const int N = static_cast<int>(state.range(0));
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int> dist(0, N * 10);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<int> data(N);
+        for (int& x : data) x = dist(rng);
+        state.ResumeTiming();
+
+        Tree tree;
+        for (int i = 0; i < N; ++i)
+            tree.insert(data[i], i);
+
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+BENCHMARK(BM_TreeInsertStdAlloc)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+
+
+// ======================================================
+// 7️⃣ Benchmark: ThreadedBinaryTree — загрузка отсортированных ключей
+//    повторным insert и from_sorted
+// ======================================================
+static std::vector<std::pair<int, int>> sorted_items(int n) {
+    std::vector<std::pair<int, int>> items(n);
+    for (int i = 0; i < n; ++i)
+        items[i] = {i * 2, i};
+    return items;
+}
+
+static void BM_TreeLoadSortedInsert(benchmark::State& state) {
+    const auto items = sorted_items(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        myds::ThreadedBinaryTree<int, int> tree;
+        for (const auto& [k, v] : items)
+            tree.insert(k, v);
+
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_TreeLoadSortedInsert)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_TreeLoadFromSorted(benchmark::State& state) {
+    const auto items = sorted_items(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        auto tree = myds::ThreadedBinaryTree<int, int>::from_sorted(items.begin(), items.end());
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_TreeLoadFromSorted)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 8️⃣ Benchmark: ThreadedBinaryTree — объединение двух деревьев
+//    поэлементной вставкой и set_union (join/split)
+// ======================================================
+static std::vector<std::pair<int, int>> random_sorted_items(int n, std::mt19937& rng) {
+    std::uniform_int_distribution<int> dist(0, n * 10);
+    std::map<int, int> m;
+    while (static_cast<int>(m.size()) < n)
+        m.emplace(dist(rng), 0);
+    return {m.begin(), m.end()};
+}
+
+static void BM_TreeUnionInsert(benchmark::State& state) {
+    std::mt19937 rng(SEED);
+    const auto a = random_sorted_items(static_cast<int>(state.range(0)), rng);
+    const auto b = random_sorted_items(static_cast<int>(state.range(0)), rng);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto tree = myds::ThreadedBinaryTree<int, int>::from_sorted(a.begin(), a.end());
+        state.ResumeTiming();
+
+        for (const auto& [k, v] : b)
+            tree.insert(k, v);
+
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_TreeUnionInsert)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_TreeSetUnion(benchmark::State& state) {
+    using Tree = myds::ThreadedBinaryTree<int, int>;
+
+    std::mt19937 rng(SEED);
+    const auto a = random_sorted_items(static_cast<int>(state.range(0)), rng);
+    const auto b = random_sorted_items(static_cast<int>(state.range(0)), rng);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto ta = Tree::from_sorted(a.begin(), a.end());
+        auto tb = Tree::from_sorted(b.begin(), b.end());
+        state.ResumeTiming();
+
+        auto tree = Tree::set_union(std::move(ta), std::move(tb));
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_TreeSetUnion)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// ======================================================
+// 9️⃣ Benchmark: ThreadedBinaryTree — дописывание возрастающих ключей
+//    обычным insert и insert с подсказкой end()
+// ======================================================
+static void BM_TreeAppendSorted(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+
+    for (auto _ : state) {
+        myds::ThreadedBinaryTree<int, int> tree;
+        for (int i = 0; i < N; ++i)
+            tree.insert(i, i);
+
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+BENCHMARK(BM_TreeAppendSorted)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_TreeAppendSortedHint(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+
+    for (auto _ : state) {
+        myds::ThreadedBinaryTree<int, int> tree;
+        for (int i = 0; i < N; ++i)
+            tree.insert(tree.end(), i, i);
+
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+BENCHMARK(BM_TreeAppendSortedHint)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 🔟 Benchmark: lower_bound / count_range — дерево на указателях
+//    и снимок freeze() в порядке Eytzinger
+//    (10^8 ключей требуют ~8 GiB и по умолчанию не запускаются)
+// ======================================================
+static constexpr int LOOKUPS = 1 << 16;
+
+static myds::ThreadedBinaryTree<int, int> random_tree(int n) {
+    std::mt19937 rng(SEED);
+    auto items = random_sorted_items(n, rng);
+    return myds::ThreadedBinaryTree<int, int>::from_sorted(items.begin(), items.end());
+}
+
+static std::vector<int> random_probes(int n) {
+    std::mt19937 rng(SEED + 1);
+    std::uniform_int_distribution<int> dist(0, n * 10);
+    std::vector<int> probes(LOOKUPS);
+    for (int& x : probes) x = dist(rng);
+    return probes;
+}
+
+static void BM_TreeLowerBound(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto tree = random_tree(N);
+    const auto probes = random_probes(N);
+
+    for (auto _ : state) {
+        long long total = 0;
+        for (int x : probes) {
+            auto it = tree.lower_bound(x);
+            if (it != tree.end()) total += it->first;
+        }
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK(BM_TreeLowerBound)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_SnapshotLowerBound(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto snapshot = random_tree(N).freeze();
+    const auto probes = random_probes(N);
+
+    for (auto _ : state) {
+        long long total = 0;
+        for (int x : probes) {
+            size_t pos = snapshot.lower_bound(x);
+            if (pos != snapshot.size()) total += snapshot[pos].first;
+        }
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK(BM_SnapshotLowerBound)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_TreeCountRangeLarge(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto tree = random_tree(N);
+    const auto probes = random_probes(N);
+
+    for (auto _ : state) {
+        size_t total = 0;
+        for (int x : probes) total += tree.count_range(x, x + N);
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK(BM_TreeCountRangeLarge)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_SnapshotCountRange(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto snapshot = random_tree(N).freeze();
+    const auto probes = random_probes(N);
+
+    for (auto _ : state) {
+        size_t total = 0;
+        for (int x : probes) total += snapshot.count_range(x, x + N);
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK(BM_SnapshotCountRange)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 1️⃣1️⃣ Benchmark: VersionedTree — читатели по снимкам при работающем писателе
+// ======================================================
+static myds::VersionedTree<myds::ThreadedBinaryTree<int, int>>* versioned = nullptr;
+
+static void BM_VersionedReaders(benchmark::State& state) {
+    const int N = 1'000'000;
+    if (state.thread_index() == 0) {
+        versioned = new myds::VersionedTree<myds::ThreadedBinaryTree<int, int>>(random_tree(N));
+    }
+    const auto probes = random_probes(N);
+    std::mt19937 rng(SEED + state.thread_index());
+    std::uniform_int_distribution<int> dist(0, N * 10);
+
+    for (auto _ : state) {
+        // Поток 0 еще и пишет: вставка и публикация новой версии на каждой итерации
+        if (state.thread_index() == 0) {
+            for (int i = 0; i < 64; ++i) versioned->insert(dist(rng), i);
+            versioned->publish();
+        }
+
+        const auto snapshot = versioned->snapshot();
+        size_t total = 0;
+        for (int x : probes) total += snapshot->count_range(x, x + N);
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+    if (state.thread_index() == 0) {
+        delete versioned;
+        versioned = nullptr;
+    }
+}
+
+BENCHMARK(BM_VersionedReaders)->ThreadRange(1, 8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Цена publish() на 10^6 ключей в зависимости от того, как долго читатель держит снимки:
+//   0 - снимков никто не держит
+//   1 - читатель держит только последнюю версию (обновляет снимок после каждой публикации)
+//   2 - читатель отстает на версию: держит две последние, publish() копирует дерево
+static void BM_VersionedPublish(benchmark::State& state) {
+    const int N = 1'000'000;
+    const int mode = static_cast<int>(state.range(0));
+    myds::VersionedTree<myds::ThreadedBinaryTree<int, int>> tree(random_tree(N));
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int> dist(0, N * 10);
+
+    std::shared_ptr<const myds::ThreadedBinaryTree<int, int>> held[2];
+    size_t round = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < 64; ++i) tree.insert(dist(rng), i);
+        tree.publish();
+
+        if (mode == 1) held[0] = tree.snapshot();
+        if (mode == 2) held[round++ % 2] = tree.snapshot();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * 64);
+}
+
+BENCHMARK(BM_VersionedPublish)->Arg(0)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+
+// ======================================================
+// 1️⃣2️⃣ Benchmark: rq — поток команд через iostream и через FastReader/FastWriter
+// ======================================================
+using RqTree = myds::ThreadedBinaryTree<
+    int, int, std::less<int>,
+    myds::PairAggregate<myds::SumAggregate<long long>, myds::MaxAggregate<int>>>;
+
+// 10% вставок, остальное - запросы q. Ключи из небольшого диапазона, чтобы
+// дерево помещалось в кэш и время уходило в основном на разбор и вывод
+static std::string command_stream(int n) {
+    const int KEYS = 1 << 16;
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int> dist(0, KEYS);
+    std::uniform_int_distribution<int> kind(0, 9);
+
+    std::string res;
+    for (int i = 0; i < n; ++i) {
+        int x = dist(rng);
+        if (kind(rng) == 0) {
+            res += "k " + std::to_string(x) + ' ';
+        } else {
+            res += "q " + std::to_string(x) + ' ' + std::to_string(x + KEYS / 100) + ' ';
+        }
+    }
+    return res;
+}
+
+template <typename In, typename Out>
+static void run_commands(In& in, Out& out) {
+    RqTree tree;
+    char command = '\0';
+    while (in >> command) {
+        rq::RangeQuery<RqTree>::process_command(tree, command, in, out);
+    }
+}
+
+static void BM_RqStreamIO(benchmark::State& state) {
+    const std::string input = command_stream(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::istringstream in(input);
+        std::ostringstream out;
+        state.ResumeTiming();
+
+        run_commands(in, out);
+        benchmark::DoNotOptimize(out.tellp());
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(input.size()));
+}
+
+BENCHMARK(BM_RqStreamIO)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_RqFastIO(benchmark::State& state) {
+    const std::string input = command_stream(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::istringstream in(input);
+        std::ostringstream out;
+        state.ResumeTiming();
+
+        {
+            rq::FastReader reader(in);
+            rq::FastWriter writer(out);
+            run_commands(reader, writer);
+        }
+        benchmark::DoNotOptimize(out.tellp());
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(input.size()));
+}
+
+BENCHMARK(BM_RqFastIO)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 1️⃣3️⃣ Benchmark: политики балансировки AVL / WAVL / красно-черное дерево
+//    вставка, смесь вставок и удалений, поиск в дереве после случайных вставок
+// ======================================================
+template <typename BalanceT>
+using BalancedTree = myds::ThreadedBinaryTree<int, int, std::less<int>, myds::NoAggregate, BalanceT>;
+
+template <typename BalanceT>
+static BalancedTree<BalanceT> random_insert_tree(int n, std::mt19937& rng) {
+    std::uniform_int_distribution<int> dist(0, n * 10);
+    BalancedTree<BalanceT> tree;
+    for (int i = 0; i < n; ++i) tree.insert(dist(rng), i);
+    return tree;
+}
+
+template <typename BalanceT>
+static void BM_TreeInsertBalance(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    std::mt19937 rng(SEED);
+
+    for (auto _ : state) {
+        auto tree = random_insert_tree<BalanceT>(N, rng);
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+BENCHMARK_TEMPLATE(BM_TreeInsertBalance, myds::AvlBalance)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_TreeInsertBalance, myds::WavlBalance)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_TreeInsertBalance, myds::RedBlackBalance)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+template <typename BalanceT>
+static void BM_TreeChurnBalance(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    std::mt19937 rng(SEED);
+    auto tree = random_insert_tree<BalanceT>(N, rng);
+    std::uniform_int_distribution<int> dist(0, N * 10);
+
+    for (auto _ : state) {
+        for (int i = 0; i < LOOKUPS; ++i) {
+            int key = dist(rng);
+            if (i % 2 == 0) {
+                tree.insert(key, i);
+            } else {
+                auto it = tree.lower_bound(key);
+                if (it != tree.end()) tree.remove(it->first);
+            }
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK_TEMPLATE(BM_TreeChurnBalance, myds::AvlBalance)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_TreeChurnBalance, myds::WavlBalance)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_TreeChurnBalance, myds::RedBlackBalance)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+template <typename BalanceT>
+static void BM_TreeFindBalance(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    std::mt19937 rng(SEED);
+    const auto tree = random_insert_tree<BalanceT>(N, rng);
+    const auto probes = random_probes(N);
+
+    for (auto _ : state) {
+        size_t found = 0;
+        for (int x : probes) found += (tree.find(x) != tree.end());
+        benchmark::DoNotOptimize(found);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK_TEMPLATE(BM_TreeFindBalance, myds::AvlBalance)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_TreeFindBalance, myds::WavlBalance)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_TreeFindBalance, myds::RedBlackBalance)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+
+
+// ======================================================
+// 1️⃣4️⃣ Benchmark: k-й элемент — std::next(begin(), k) против nth(k) по размерам поддеревьев
+// ======================================================
+static void BM_TreeNextK(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto tree = random_tree(N);
+    const int Q = 100;
+
+    std::mt19937 rng(SEED + 2);
+    std::uniform_int_distribution<size_t> dist(0, tree.size() - 1);
+
+    for (auto _ : state) {
+        long long total = 0;
+        for (int i = 0; i < Q; ++i) total += std::next(tree.begin(), dist(rng))->first;
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * Q);
+}
+
+BENCHMARK(BM_TreeNextK)->Arg(100'000)->Arg(1'000'000);
+
+static void BM_TreeNth(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto tree = random_tree(N);
+    const int Q = 100;
+
+    std::mt19937 rng(SEED + 2);
+    std::uniform_int_distribution<size_t> dist(0, tree.size() - 1);
+
+    for (auto _ : state) {
+        long long total = 0;
+        for (int i = 0; i < Q; ++i) total += tree.nth(dist(rng))->first;
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * Q);
+}
+
+BENCHMARK(BM_TreeNth)->Arg(100'000)->Arg(1'000'000);
+
+
+// ======================================================
+// 1️⃣5️⃣ Benchmark: вырезание окна из state.range(0) ключей из дерева на 10^6 ключей
+//    remove по одному ключу против erase_range через split/join
+//    (число итераций фиксировано: каждая заново строит дерево вне замера)
+// ======================================================
+static void BM_TreeEraseWindowRemove(benchmark::State& state) {
+    const int N = 1'000'000;
+    const int K = static_cast<int>(state.range(0));
+    const auto items = sorted_items(N);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto tree = myds::ThreadedBinaryTree<int, int>::from_sorted(items.begin(), items.end());
+        state.ResumeTiming();
+
+        for (int i = N / 2; i < N / 2 + K; ++i) tree.remove(i * 2);
+        benchmark::DoNotOptimize(tree.size());
+
+        state.PauseTiming();
+        { auto drop = std::move(tree); }
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * K);
+}
+
+BENCHMARK(BM_TreeEraseWindowRemove)->Arg(1'000)->Arg(100'000)->Iterations(20)->Unit(benchmark::kMicrosecond);
+
+static void BM_TreeEraseWindowRange(benchmark::State& state) {
+    const int N = 1'000'000;
+    const int K = static_cast<int>(state.range(0));
+    const auto items = sorted_items(N);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto tree = myds::ThreadedBinaryTree<int, int>::from_sorted(items.begin(), items.end());
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(tree.erase_range(N, N + 2 * K - 1));
+
+        state.PauseTiming();
+        { auto drop = std::move(tree); }
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * K);
+}
+
+BENCHMARK(BM_TreeEraseWindowRange)->Arg(1'000)->Arg(100'000)->Iterations(20)->Unit(benchmark::kMicrosecond);
+
+
+// ======================================================
+// 1️⃣6️⃣ Benchmark: загрузка неупорядоченных ключей (около 10% повторов)
+//    поочередным insert против from_unsorted (параллельные сортировка и сборка)
+// ======================================================
+static std::vector<std::pair<int, int>> unsorted_items(int n) {
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int> dist(0, n * 5);
+    std::vector<std::pair<int, int>> items(n);
+    for (int i = 0; i < n; ++i)
+        items[i] = {dist(rng), i};
+    return items;
+}
+
+static void BM_TreeLoadUnsortedInsert(benchmark::State& state) {
+    const auto items = unsorted_items(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        myds::ThreadedBinaryTree<int, int> tree;
+        for (const auto& [k, v] : items)
+            tree.insert(k, v);
+
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_TreeLoadUnsortedInsert)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond);
+
+static void BM_TreeLoadFromUnsorted(benchmark::State& state) {
+    const auto items = unsorted_items(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        auto tree = myds::ThreadedBinaryTree<int, int>::from_unsorted(items.begin(), items.end());
+        benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * state.range(0));
+}
+
+BENCHMARK(BM_TreeLoadFromUnsorted)->Arg(1'000'000)->Arg(10'000'000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// ======================================================
+// 1️⃣7️⃣ Benchmark: пересечения с [L, L + 1000] среди state.range(0) отрезков
+//    (1% длинных, до 10^6): эмуляция по ключам-началам против IntervalTree.
+//    Эмуляции нужна максимальная длина: она просматривает все начала из [L - MAX_LEN, R]
+// ======================================================
+static const int INTERVAL_SPACE = 100'000'000;
+static const int INTERVAL_MAX_LEN = 1'000'000;
+static const int INTERVAL_QUERY_LEN = 1'000;
+
+static std::vector<std::pair<int, int>> random_intervals(int n) {
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int> start(0, INTERVAL_SPACE);
+    std::uniform_int_distribution<int> length(0, 1'000);
+    std::uniform_int_distribution<int> long_length(0, INTERVAL_MAX_LEN);
+    std::vector<std::pair<int, int>> res(n);
+    for (int i = 0; i < n; ++i) {
+        int lo = start(rng);
+        res[i] = {lo, lo + (i % 100 == 0 ? long_length(rng) : length(rng))};
+    }
+    return res;
+}
+
+static void BM_IntervalOverlapKeyScan(benchmark::State& state) {
+    const auto intervals = random_intervals(static_cast<int>(state.range(0)));
+    myds::ThreadedBinaryTree<std::pair<int, int>, int> tree;
+    for (const auto& interval : intervals)
+        tree.insert(interval, 0);
+
+    std::mt19937 rng(SEED + 3);
+    std::uniform_int_distribution<int> dist(0, INTERVAL_SPACE);
+
+    for (auto _ : state) {
+        int l = dist(rng);
+        int r = l + INTERVAL_QUERY_LEN;
+        size_t found = 0;
+        auto last = tree.upper_bound({r, std::numeric_limits<int>::max()});
+        for (auto it = tree.lower_bound({l - INTERVAL_MAX_LEN, 0}); it != last; ++it)
+            found += (it->first.second >= l);
+        benchmark::DoNotOptimize(found);
+    }
+}
+
+BENCHMARK(BM_IntervalOverlapKeyScan)->Arg(1'000'000);
+
+static void BM_IntervalOverlapTree(benchmark::State& state) {
+    const auto intervals = random_intervals(static_cast<int>(state.range(0)));
+    myds::IntervalTree<int> tree;
+    for (const auto& [lo, hi] : intervals)
+        tree.insert(lo, hi);
+
+    std::mt19937 rng(SEED + 3);
+    std::uniform_int_distribution<int> dist(0, INTERVAL_SPACE);
+
+    for (auto _ : state) {
+        int l = dist(rng);
+        benchmark::DoNotOptimize(tree.count_overlaps(l, l + INTERVAL_QUERY_LEN));
+    }
+}
+
+BENCHMARK(BM_IntervalOverlapTree)->Arg(1'000'000);
+
+// ======================================================
+// 1️⃣8️⃣ Benchmark: просмотр окна из state.range(0) ключей в дереве на 10^7 ключей,
+//    вставленных в случайном порядке (соседи по ключу лежат в памяти вразброс):
+//    std::distance(lower_bound, upper_bound) против for_each_in_range
+// ======================================================
+static const myds::ThreadedBinaryTree<int, int>& scattered_tree() {
+    static const auto tree = [] {
+        const int N = 10'000'000;
+        std::vector<int> keys(N);
+        for (int i = 0; i < N; ++i) keys[i] = i;
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(SEED));
+
+        myds::ThreadedBinaryTree<int, int> res;
+        for (int key : keys) res.insert(key, key);
+        return res;
+    }();
+    return tree;
+}
+
+static void BM_TreeScanDistance(benchmark::State& state) {
+    const auto& tree = scattered_tree();
+    const int K = static_cast<int>(state.range(0));
+    std::mt19937 rng(SEED + 4);
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(tree.size()) - K);
+
+    for (auto _ : state) {
+        int l = dist(rng);
+        benchmark::DoNotOptimize(std::distance(tree.lower_bound(l), tree.upper_bound(l + K - 1)));
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * K);
+}
+
+static void BM_TreeScanForEach(benchmark::State& state) {
+    const auto& tree = scattered_tree();
+    const int K = static_cast<int>(state.range(0));
+    std::mt19937 rng(SEED + 4);
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(tree.size()) - K);
+
+    for (auto _ : state) {
+        int l = dist(rng);
+        size_t count = 0;
+        tree.for_each_in_range(l, l + K - 1, [&](const auto&) { ++count; });
+        benchmark::DoNotOptimize(count);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * K);
+}
+
+BENCHMARK(BM_TreeScanDistance)->Arg(1'000)->Arg(100'000);
+BENCHMARK(BM_TreeScanForEach)->Arg(1'000)->Arg(100'000);
+
+// ======================================================
+// 1️⃣9️⃣ Benchmark: память на ключ и поиск по 10^6 случайным ключам,
+//    ThreadedBinaryTree, CompactThreadedTree и std::map. Байты считает CountingAllocator
+// ======================================================
+static size_t counted_bytes = 0;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template <typename U> CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        counted_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* ptr, size_t n) {
+        counted_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    bool operator==(const CountingAllocator&) const { return true; }
+};
+
+template <typename Container, typename Insert>
+static void footprint_find(benchmark::State& state, Insert insert) {
+    const int N = static_cast<int>(state.range(0));
+    std::vector<int> keys(N);
+    for (int i = 0; i < N; ++i) keys[i] = i;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(SEED));
+
+    counted_bytes = 0;
+    Container cont;
+    for (int key : keys) insert(cont, key);
+    const double bytes = static_cast<double>(counted_bytes);
+
+    std::mt19937 rng(SEED + 5);
+    std::uniform_int_distribution<int> dist(0, N - 1);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cont.find(dist(rng)));
+
+    state.counters["bytes_per_key"] = bytes / N;
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+
+static void BM_TreeFootprintFind(benchmark::State& state) {
+    using Tree = myds::ThreadedBinaryTree<int, int, std::less<int>,
+                                          myds::NoAggregate, myds::AvlBalance,
+                                          CountingAllocator<std::pair<const int, int>>>;
+    footprint_find<Tree>(state, [](Tree& tree, int key) { tree.insert(key, key); });
+}
+
+static void BM_CompactFootprintFind(benchmark::State& state) {
+    using Tree = myds::CompactThreadedTree<int, int, std::less<int>,
+                                           CountingAllocator<std::pair<const int, int>>>;
+    footprint_find<Tree>(state, [](Tree& tree, int key) { tree.insert(key, key); });
+}
+
+static void BM_MapFootprintFind(benchmark::State& state) {
+    using Map = std::map<int, int, std::less<int>, CountingAllocator<std::pair<const int, int>>>;
+    footprint_find<Map>(state, [](Map& map, int key) { map.emplace(key, key); });
+}
+
+BENCHMARK(BM_TreeFootprintFind)->Arg(1'000'000);
+BENCHMARK(BM_CompactFootprintFind)->Arg(1'000'000);
+BENCHMARK(BM_MapFootprintFind)->Arg(1'000'000);
+
+// ======================================================
+// 2️⃣0️⃣ Benchmark: ThreadedBinaryTree против CompactThreadedTree на 10^7 ключах,
+//    вставленных в случайном порядке: count_range и проход итератором по окну
+//    из 1000 ключей
+// ======================================================
+template <typename Tree>
+static const Tree& scattered(int n) {
+    static const Tree tree = [n] {
+        std::vector<int> keys(n);
+        for (int i = 0; i < n; ++i) keys[i] = i;
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(SEED));
+
+        Tree res;
+        for (int key : keys) res.insert(key, key);
+        return res;
+    }();
+    return tree;
+}
+
+template <typename Tree>
+static void BM_LayoutCountRange(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto& tree = scattered<Tree>(N);
+    std::mt19937 rng(SEED + 6);
+    std::uniform_int_distribution<int> dist(0, N - 1);
+
+    for (auto _ : state) {
+        int l = dist(rng);
+        benchmark::DoNotOptimize(tree.count_range(l, l + 1000));
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()));
+}
+
+template <typename Tree>
+static void BM_LayoutScan(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto& tree = scattered<Tree>(N);
+    std::mt19937 rng(SEED + 7);
+    std::uniform_int_distribution<int> dist(0, N - 1000);
+
+    for (auto _ : state) {
+        long long sum = 0;
+        auto it = tree.lower_bound(dist(rng));
+        for (int i = 0; i < 1000; ++i, ++it) sum += it->second;
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * 1000);
+}
+
+BENCHMARK_TEMPLATE(BM_LayoutCountRange, myds::ThreadedBinaryTree<int, int>)->Arg(10'000'000);
+BENCHMARK_TEMPLATE(BM_LayoutCountRange, myds::CompactThreadedTree<int, int>)->Arg(10'000'000);
+BENCHMARK_TEMPLATE(BM_LayoutScan, myds::ThreadedBinaryTree<int, int>)->Arg(10'000'000);
+BENCHMARK_TEMPLATE(BM_LayoutScan, myds::CompactThreadedTree<int, int>)->Arg(10'000'000);
+
 // ======================================================
 BENCHMARK_MAIN();
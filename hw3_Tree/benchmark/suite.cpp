@@ -0,0 +1,379 @@
+// Сравнение ThreadedBinaryTree с std::map и absl::btree_map (если он найден при сборке)
+// на типовых операциях. Машиночитаемый отчет:
+//   ./benchmark --benchmark_out=benchmark.json --benchmark_out_format=json
+// или цель benchmark_json
+
+#include <map>
+#include <string>
+#include <vector>
+#include <string_view>
+#include <random>
+#include <numeric>
+#include <algorithm>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <benchmark/benchmark.h>
+
+#include "tree.hpp"
+
+#ifdef TREE_BENCHMARK_ABSL
+#include <absl/container/btree_map.h>
+#endif
+
+namespace {
+
+const int SUITE_SEED = 4242;
+
+using StdMap = std::map<int, int>;
+using Tree   = myds::ThreadedBinaryTree<int, int>;
+
+using StdStringMap = std::map<std::string, int>;
+using StringTree   = myds::ThreadedBinaryTree<std::string, int>;
+
+using StdStringMapTransparent = std::map<std::string, int, std::less<>>;
+using StringTreeTransparent   = myds::ThreadedBinaryTree<std::string, int, std::less<>>;
+
+#ifdef TREE_BENCHMARK_ABSL
+using BTree       = absl::btree_map<int, int>;
+using StringBTree = absl::btree_map<std::string, int>;
+#endif
+
+// ---- единый интерфейс контейнеров ----
+
+template <typename Map, typename K>
+void put(Map& m, const K& key, int value) { m.emplace(key, value); }
+
+template <typename K, typename V, typename C, typename A, typename B, typename Al>
+void put(myds::ThreadedBinaryTree<K, V, C, A, B, Al>& t, const K& key, int value) { t.insert(key, value); }
+
+template <typename Map, typename K>
+void erase_key(Map& m, const K& key) { m.erase(key); }
+
+template <typename K, typename V, typename C, typename A, typename B, typename Al>
+void erase_key(myds::ThreadedBinaryTree<K, V, C, A, B, Al>& t, const K& key) { t.remove(key); }
+
+// Четные ключи в случайном порядке: нечетные гарантированно промахиваются
+std::vector<int> shuffled_keys(int n) {
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; ++i) keys[i] = i * 2;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(SUITE_SEED));
+    return keys;
+}
+
+template <typename Map>
+Map build(const std::vector<int>& keys) {
+    Map m;
+    for (int key : keys) put(m, key, key);
+    return m;
+}
+
+std::vector<std::string> string_keys(int n) {
+    std::vector<std::string> keys(n);
+    for (int i = 0; i < n; ++i) keys[i] = "user:" + std::to_string(i * 7919 % n) + ":session";
+    return keys;
+}
+
+// Порядки вставки: по возрастанию, по убыванию и "зигзаг" 0, n-1, 1, n-2, ... -
+// каждый новый ключ встает на край дерева, чередуя стороны
+enum InsertOrder { Ascending, Descending, ZigZag, Random };
+
+std::vector<int> ordered_keys(int n, InsertOrder order) {
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    switch (order) {
+        case Ascending: break;
+        case Descending: std::reverse(keys.begin(), keys.end()); break;
+        case ZigZag:
+            for (int i = 0; i < n; ++i) keys[i] = (i % 2 == 0) ? i / 2 : n - 1 - i / 2;
+            break;
+        case Random: std::shuffle(keys.begin(), keys.end(), std::mt19937(SUITE_SEED)); break;
+    }
+    return keys;
+}
+
+const int LOOKUPS = 1 << 16;
+
+} // namespace
+
+// ======================================================
+// Поиск: попадания и промахи
+// ======================================================
+template <typename Map>
+static void BM_FindHit(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto keys = shuffled_keys(N);
+    const Map m = build<Map>(keys);
+
+    for (auto _ : state) {
+        size_t found = 0;
+        for (int i = 0; i < LOOKUPS; ++i) found += (m.find(keys[i % N]) != m.end());
+        benchmark::DoNotOptimize(found);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+template <typename Map>
+static void BM_FindMiss(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto keys = shuffled_keys(N);
+    const Map m = build<Map>(keys);
+
+    for (auto _ : state) {
+        size_t found = 0;
+        for (int i = 0; i < LOOKUPS; ++i) found += (m.find(keys[i % N] + 1) != m.end());
+        benchmark::DoNotOptimize(found);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK_TEMPLATE(BM_FindHit, StdMap)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(BM_FindHit, Tree)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(BM_FindMiss, StdMap)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(BM_FindMiss, Tree)->Arg(100'000)->Arg(1'000'000);
+#ifdef TREE_BENCHMARK_ABSL
+BENCHMARK_TEMPLATE(BM_FindHit, BTree)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(BM_FindMiss, BTree)->Arg(100'000)->Arg(1'000'000);
+#endif
+
+// ======================================================
+// Удаление всех ключей в случайном порядке
+// ======================================================
+template <typename Map>
+static void BM_RemoveAll(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto keys = shuffled_keys(N);
+    auto order = keys;
+    std::shuffle(order.begin(), order.end(), std::mt19937(SUITE_SEED + 1));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Map m = build<Map>(keys);
+        state.ResumeTiming();
+
+        for (int key : order) erase_key(m, key);
+        benchmark::DoNotOptimize(m);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+BENCHMARK_TEMPLATE(BM_RemoveAll, StdMap)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_RemoveAll, Tree)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+#ifdef TREE_BENCHMARK_ABSL
+BENCHMARK_TEMPLATE(BM_RemoveAll, BTree)->Arg(100'000)->Arg(1'000'000)->Unit(benchmark::kMillisecond);
+#endif
+
+// ======================================================
+// Полный обход в прямом и обратном порядке
+// ======================================================
+template <typename Map>
+static void BM_Iterate(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const Map m = build<Map>(shuffled_keys(N));
+
+    for (auto _ : state) {
+        long long total = 0;
+        for (auto it = m.begin(); it != m.end(); ++it) total += it->second;
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+template <typename Map>
+static void BM_ReverseIterate(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const Map m = build<Map>(shuffled_keys(N));
+
+    for (auto _ : state) {
+        long long total = 0;
+        for (auto it = m.crbegin(); it != m.crend(); ++it) total += it->second;
+        benchmark::DoNotOptimize(total);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+BENCHMARK_TEMPLATE(BM_Iterate, StdMap)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(BM_Iterate, Tree)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(BM_ReverseIterate, StdMap)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(BM_ReverseIterate, Tree)->Arg(100'000)->Arg(1'000'000);
+#ifdef TREE_BENCHMARK_ABSL
+BENCHMARK_TEMPLATE(BM_Iterate, BTree)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_TEMPLATE(BM_ReverseIterate, BTree)->Arg(100'000)->Arg(1'000'000);
+#endif
+
+// ======================================================
+// Смешанная нагрузка: state.range(1) процентов чтений, остальное - вставки и удаления поровну
+// ======================================================
+template <typename Map>
+static void BM_Mixed(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const int read_percent = static_cast<int>(state.range(1));
+    Map m = build<Map>(shuffled_keys(N));
+
+    std::mt19937 rng(SUITE_SEED);
+    std::uniform_int_distribution<int> key_dist(0, 2 * N);
+    std::uniform_int_distribution<int> op_dist(0, 99);
+
+    for (auto _ : state) {
+        size_t found = 0;
+        for (int i = 0; i < LOOKUPS; ++i) {
+            int key = key_dist(rng);
+            int op = op_dist(rng);
+            if (op < read_percent) {
+                found += (m.find(key) != m.end());
+            } else if (op % 2 == 0) {
+                put(m, key, i);
+            } else {
+                erase_key(m, key);
+            }
+        }
+        benchmark::DoNotOptimize(found);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK_TEMPLATE(BM_Mixed, StdMap)->ArgsProduct({{1'000'000}, {50, 90, 99}});
+BENCHMARK_TEMPLATE(BM_Mixed, Tree)->ArgsProduct({{1'000'000}, {50, 90, 99}});
+#ifdef TREE_BENCHMARK_ABSL
+BENCHMARK_TEMPLATE(BM_Mixed, BTree)->ArgsProduct({{1'000'000}, {50, 90, 99}});
+#endif
+
+// ======================================================
+// Вставка в разных порядках: state.range(1) - InsertOrder
+// ======================================================
+template <typename Map>
+static void BM_InsertOrder(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto keys = ordered_keys(N, static_cast<InsertOrder>(state.range(1)));
+
+    for (auto _ : state) {
+        Map m = build<Map>(keys);
+        benchmark::DoNotOptimize(m);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+BENCHMARK_TEMPLATE(BM_InsertOrder, StdMap)
+    ->ArgsProduct({{1'000'000}, {Ascending, Descending, ZigZag, Random}})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_InsertOrder, Tree)
+    ->ArgsProduct({{1'000'000}, {Ascending, Descending, ZigZag, Random}})->Unit(benchmark::kMillisecond);
+#ifdef TREE_BENCHMARK_ABSL
+BENCHMARK_TEMPLATE(BM_InsertOrder, BTree)
+    ->ArgsProduct({{1'000'000}, {Ascending, Descending, ZigZag, Random}})->Unit(benchmark::kMillisecond);
+#endif
+
+// ======================================================
+// Строковые ключи: вставка и поиск
+// ======================================================
+template <typename Map>
+static void BM_StringInsert(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto keys = string_keys(N);
+
+    for (auto _ : state) {
+        Map m;
+        for (int i = 0; i < N; ++i) put(m, keys[i], i);
+        benchmark::DoNotOptimize(m);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * N);
+}
+
+template <typename Map>
+static void BM_StringFind(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto keys = string_keys(N);
+    Map m;
+    for (int i = 0; i < N; ++i) put(m, keys[i], i);
+
+    for (auto _ : state) {
+        size_t found = 0;
+        for (int i = 0; i < LOOKUPS; ++i) found += (m.find(keys[(i * 31) % N]) != m.end());
+        benchmark::DoNotOptimize(found);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK_TEMPLATE(BM_StringInsert, StdStringMap)->Arg(100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_StringInsert, StringTree)->Arg(100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_StringFind, StdStringMap)->Arg(100'000);
+BENCHMARK_TEMPLATE(BM_StringFind, StringTree)->Arg(100'000);
+#ifdef TREE_BENCHMARK_ABSL
+BENCHMARK_TEMPLATE(BM_StringInsert, StringBTree)->Arg(100'000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_StringFind, StringBTree)->Arg(100'000);
+#endif
+
+// Поиск по std::string_view (ключи из входного буфера). Без прозрачного компаратора
+// на каждый поиск строится временный std::string - ключи длиннее SSO, это аллокация
+template <typename Map>
+static void BM_StringViewFind(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto keys = string_keys(N);
+    Map m;
+    for (int i = 0; i < N; ++i) put(m, keys[i], i);
+
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+
+    for (auto _ : state) {
+        size_t found = 0;
+        for (int i = 0; i < LOOKUPS; ++i) {
+            std::string_view key = views[(i * 31) % N];
+            if constexpr (requires { m.find(key); }) {
+                found += (m.find(key) != m.end());
+            } else {
+                found += (m.find(std::string(key)) != m.end());
+            }
+        }
+        benchmark::DoNotOptimize(found);
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * LOOKUPS);
+}
+
+BENCHMARK_TEMPLATE(BM_StringViewFind, StdStringMap)->Arg(100'000);
+BENCHMARK_TEMPLATE(BM_StringViewFind, StdStringMapTransparent)->Arg(100'000);
+BENCHMARK_TEMPLATE(BM_StringViewFind, StringTree)->Arg(100'000);
+BENCHMARK_TEMPLATE(BM_StringViewFind, StringTreeTransparent)->Arg(100'000);
+
+// ======================================================
+// Память на элемент: прирост занятой кучи glibc после построения контейнера
+// (счетчик bytes_per_element; на других libc не измеряется)
+// ======================================================
+#if defined(__GLIBC__)
+static size_t heap_in_use() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+template <typename Map>
+static void BM_MemoryPerElement(benchmark::State& state) {
+    const int N = static_cast<int>(state.range(0));
+    const auto keys = shuffled_keys(N);
+
+    double bytes_per_element = 0;
+    for (auto _ : state) {
+        size_t before = heap_in_use();
+        Map m = build<Map>(keys);
+        bytes_per_element = static_cast<double>(heap_in_use() - before) / N;
+        benchmark::DoNotOptimize(m);
+    }
+
+    state.counters["bytes_per_element"] = bytes_per_element;
+}
+
+BENCHMARK_TEMPLATE(BM_MemoryPerElement, StdMap)->Arg(1'000'000)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MemoryPerElement, Tree)->Arg(1'000'000)->Iterations(1)->Unit(benchmark::kMillisecond);
+#ifdef TREE_BENCHMARK_ABSL
+BENCHMARK_TEMPLATE(BM_MemoryPerElement, BTree)->Arg(1'000'000)->Iterations(1)->Unit(benchmark::kMillisecond);
+#endif
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <utility>
+#include <optional>
+#include <algorithm>
+
+namespace myds {
+
+// Моноиды для аугментации ThreadedBinaryTree.
+// Агрегат задает тип результата и три статические функции:
+//   result_type identity()                           - нейтральный элемент
+//   result_type lift(const Key&, const Value&)       - значение одного элемента
+//   result_type combine(const result_type& left, const result_type& right)
+// combine должна быть ассоциативной; коммутативность не требуется -
+// левый аргумент всегда относится к меньшим ключам
+
+// Без аугментации: узел не хранит ничего лишнего
+struct NoAggregate {
+  struct result_type {};
+
+  static result_type identity() { return {}; }
+
+  template<typename KeyT, typename ValueT>
+  static result_type lift(const KeyT&, const ValueT&) { return {}; }
+
+  static result_type combine(const result_type&, const result_type&) { return {}; }
+};
+
+template<typename T>
+struct SumAggregate {
+  using result_type = T;
+
+  static result_type identity() { return T{}; }
+
+  template<typename KeyT, typename ValueT>
+  static result_type lift(const KeyT&, const ValueT& value) { return static_cast<T>(value); }
+
+  static result_type combine(const result_type& lhs, const result_type& rhs) { return lhs + rhs; }
+};
+
+// Для пустого диапазона min/max - std::nullopt
+template<typename T>
+struct MinAggregate {
+  using result_type = std::optional<T>;
+
+  static result_type identity() { return std::nullopt; }
+
+  template<typename KeyT, typename ValueT>
+  static result_type lift(const KeyT&, const ValueT& value) { return static_cast<T>(value); }
+
+  static result_type combine(const result_type& lhs, const result_type& rhs) {
+    if (!lhs) { return rhs; }
+    if (!rhs) { return lhs; }
+    return std::min(*lhs, *rhs);
+  }
+};
+
+template<typename T>
+struct MaxAggregate {
+  using result_type = std::optional<T>;
+
+  static result_type identity() { return std::nullopt; }
+
+  template<typename KeyT, typename ValueT>
+  static result_type lift(const KeyT&, const ValueT& value) { return static_cast<T>(value); }
+
+  static result_type combine(const result_type& lhs, const result_type& rhs) {
+    if (!lhs) { return rhs; }
+    if (!rhs) { return lhs; }
+    return std::max(*lhs, *rhs);
+  }
+};
+
+// Максимум правых концов интервалов, хранящихся ключом std::pair<T, T> (начало, конец).
+// Основа IntervalTree
+template<typename T>
+struct MaxEndAggregate : MaxAggregate<T> {
+  template<typename KeyT, typename ValueT>
+  static typename MaxAggregate<T>::result_type lift(const KeyT& key, const ValueT&) { return key.second; }
+};
+
+// Два агрегата сразу, результат - пара
+template<typename FirstAgg, typename SecondAgg>
+struct PairAggregate {
+  using result_type = std::pair<typename FirstAgg::result_type, typename SecondAgg::result_type>;
+
+  static result_type identity() { return {FirstAgg::identity(), SecondAgg::identity()}; }
+
+  template<typename KeyT, typename ValueT>
+  static result_type lift(const KeyT& key, const ValueT& value) {
+    return {FirstAgg::lift(key, value), SecondAgg::lift(key, value)};
+  }
+
+  static result_type combine(const result_type& lhs, const result_type& rhs) {
+    return {FirstAgg::combine(lhs.first, rhs.first), SecondAgg::combine(lhs.second, rhs.second)};
+  }
+};
+
+} // namespace myds
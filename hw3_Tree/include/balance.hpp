@@ -0,0 +1,24 @@
+#pragma once
+
+namespace myds {
+
+// Политики балансировки ThreadedBinaryTree.
+// Все три схемы - ранговые: в байте node->height хранится ранг узла, у отсутствующего
+// ребенка ранг 0, у листа - 1. Схемы различаются допустимыми разностями рангов
+// родителя и ребенка. Нити и вспомогательные поля узлов (size, agg) от схемы не зависят
+
+// AVL: ранг - это высота, у детей она отличается не больше чем на 1.
+// Самое низкое дерево (~1.44 log n): быстрее поиск
+struct AvlBalance {};
+
+// WAVL (weak AVL): разности рангов 1 или 2, лист имеет ранг 1.
+// Вставка совпадает с AVL, а удаление делает не больше двух поворотов
+// и не перестраивает дерево до корня. Высота не больше 2 log n
+struct WavlBalance {};
+
+// Красно-черное дерево в ранговой записи: ранг - черная высота, разности 0 или 1,
+// ребенок с разностью 0 (красный) не имеет детей с разностью 0.
+// Не больше двух поворотов на вставку и трех на удаление, высота не больше 2 log n
+struct RedBlackBalance {};
+
+} // namespace myds
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+#include "range_query.hpp"
+
+namespace rq {
+
+// Постоянный пул потоков для parallel_for. Вызывающий поток работает вместе с пулом,
+// индексы раздаются блоками через общий атомарный счетчик
+class QueryPool {
+public:
+  explicit QueryPool(size_t threads) {
+    for (size_t i = 1; i < threads; ++i) {
+      workers_.emplace_back([this] { work(); });
+    }
+  }
+
+  QueryPool(const QueryPool&) = delete;
+  QueryPool& operator=(const QueryPool&) = delete;
+
+  ~QueryPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) { worker.join(); }
+  }
+
+  size_t threads() const { return workers_.size() + 1; }
+
+  // body(i) для всех i из [0, n). body не должен бросать исключений
+  void parallel_for(size_t n, const std::function<void(size_t)>& body) {
+    if (workers_.empty() || n < PARALLEL_CUTOFF) {
+      for (size_t i = 0; i < n; ++i) { body(i); }
+      return;
+    }
+
+    {
+      std::lock_guard lock(mutex_);
+      body_ = &body;
+      size_ = n;
+      next_.store(0, std::memory_order_relaxed);
+      busy_ = workers_.size();
+      ++generation_;
+    }
+    wake_.notify_all();
+
+    run();
+
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+    body_ = nullptr;
+  }
+
+private:
+  // Меньшие пакеты дешевле решить в одном потоке, чем будить пул
+  static constexpr size_t PARALLEL_CUTOFF = 256;
+  static constexpr size_t CHUNK = 64;
+
+  void work() {
+    size_t seen = 0;
+    std::unique_lock lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) { return; }
+      seen = generation_;
+
+      lock.unlock();
+      run();
+      lock.lock();
+
+      if (--busy_ == 0) { done_.notify_one(); }
+    }
+  }
+
+  void run() {
+    for (size_t begin = next_.fetch_add(CHUNK); begin < size_; begin = next_.fetch_add(CHUNK)) {
+      size_t end = std::min(begin + CHUNK, size_);
+      for (size_t i = begin; i < end; ++i) { (*body_)(i); }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  bool stop_{false};
+  size_t generation_{0};
+  size_t busy_{0};
+
+  const std::function<void(size_t)>* body_{nullptr};
+  size_t size_{0};
+  std::atomic<size_t> next_{0};
+};
+
+// Пакетный режим rq: подряд идущие запросы q/s/m копятся до следующей вставки
+// (или до MAX_BATCH штук), решаются параллельно по неизменному в это время дереву
+// и выводятся в исходном порядке. Вывод совпадает с RangeQuery::process_command
+template <typename TreeT>
+class BatchRangeQuery {
+public:
+  explicit BatchRangeQuery(size_t threads) : pool_(std::max<size_t>(threads, 1)) {}
+
+  // Обрабатывает команды до конца потока или команды 'e'; command и результат -
+  // как у RangeQuery::run. При ошибке ответы на уже прочитанные запросы выводятся
+  // до исключения
+  template <typename In, typename Out>
+  char run(TreeT& tree, In& in, Out& out, char command = '\0') {
+    try {
+      for (bool have = command != '\0' || (in >> command); have && command != 'e';
+           have = static_cast<bool>(in >> command)) {
+        if (Query::needs_aggregate(command)) {
+          flush(tree, out);
+          return command;
+        }
+
+        if (!Query::is_range_command(command)) {
+          flush(tree, out);
+          Query::process_command(tree, command, in, out);
+          continue;
+        }
+
+        auto [left_bound, right_bound] = Query::read_bounds(in);
+        batch_.push_back({command, left_bound, right_bound});
+        if (batch_.size() == MAX_BATCH) { flush(tree, out); }
+      }
+    } catch (...) {
+      flush(tree, out);
+      throw;
+    }
+    flush(tree, out);
+    return '\0';
+  }
+
+private:
+  using Query = RangeQuery<TreeT>;
+
+  static constexpr size_t MAX_BATCH = size_t{1} << 16;
+
+  struct Request {
+    char command;
+    int left_bound;
+    int right_bound;
+  };
+
+  template <typename Out>
+  void flush(const TreeT& tree, Out& out) {
+    if (batch_.empty()) { return; }
+
+    answers_.resize(batch_.size());
+    pool_.parallel_for(batch_.size(), [&](size_t i) {
+      const Request& req = batch_[i];
+      answers_[i] = Query::answer(tree, req.command, req.left_bound, req.right_bound);
+    });
+
+    for (const auto& res : answers_) { Query::write_answer(out, res); }
+    batch_.clear();
+    answers_.clear();
+  }
+
+  QueryPool pool_;
+  std::vector<Request> batch_;
+  std::vector<std::optional<long long>> answers_;
+};
+
+} // namespace rq
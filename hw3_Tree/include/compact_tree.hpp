@@ -0,0 +1,413 @@
+#pragma once
+
+/*
+CompactThreadedTree - компактный режим прошитого AVL-дерева для больших наборов
+ключей с потоком вставок и запросов (без удаления).
+
+Узлы лежат подряд в одном векторе и ссылаются друг на друга 32-битными индексами.
+Младший бит ссылки - метка нити: 0 - ссылка на ребенка, 1 - нить к соседу по порядку
+(у крайних узлов - к nil). Родителя в узле нет: подъем при вставке идет по пути,
+запомненному при спуске. Высота хранится в байте, размер поддерева - в 32 битах.
+Для <int, int> узел занимает 24 байта против 48 у ThreadedBinaryTree, поэтому
+в кэш попадает вдвое больше узлов на спуске и на обходе.
+
+Элементов не больше 2^31 - 1 (индекс с меткой занимает 32 бита)
+*/
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+
+namespace myds {
+
+template<
+  typename KeyT, typename ValueT, typename CompT = std::less<KeyT>,
+  typename AllocT = std::allocator<std::pair<const KeyT, ValueT>>
+>
+class CompactThreadedTree {
+private:
+  using Link = uint32_t;
+
+  // Индекс "нет узла": nil с меткой нити еще помещается в 32 бита
+  static constexpr uint32_t nil = std::numeric_limits<uint32_t>::max() >> 1;
+
+  // Высота AVL-дерева из меньше чем 2^31 узлов не больше 45
+  static constexpr size_t max_height = 48;
+
+  struct Node {
+    std::pair<const KeyT, ValueT> data;
+
+    Link left;
+    Link right;
+    uint32_t size;
+    uint8_t  height;
+  };
+
+  using NodeAlloc = typename std::allocator_traits<AllocT>::template rebind_alloc<Node>;
+
+  class ConstIterator {
+  public:
+    using value_type = std::pair<const KeyT, ValueT>;
+    using pointer    = const value_type*;
+    using reference  = const value_type&;
+    using difference_type   = std::ptrdiff_t;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    ConstIterator() = default;
+
+    reference operator*() const noexcept {
+      return tree_->nodes_[index_].data;
+    }
+
+    pointer operator->() const noexcept {
+      return &(tree_->nodes_[index_].data);
+    }
+
+    ConstIterator& operator++() noexcept {
+      Link right = tree_->nodes_[index_].right;
+      index_ = is_thread(right) ? target(right) : tree_->left_most(target(right));
+      return *this;
+    }
+
+    ConstIterator operator++(int) noexcept {
+      ConstIterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    // --end() - наибольший элемент
+    ConstIterator& operator--() noexcept {
+      if (index_ == nil) {
+        index_ = tree_->right_most(tree_->root_);
+        return *this;
+      }
+      Link left = tree_->nodes_[index_].left;
+      index_ = is_thread(left) ? target(left) : tree_->right_most(target(left));
+      return *this;
+    }
+
+    ConstIterator operator--(int) noexcept {
+      ConstIterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    bool operator==(const ConstIterator& other) const noexcept {
+      return index_ == other.index_;
+    }
+
+  private:
+    friend class CompactThreadedTree;
+
+    ConstIterator(const CompactThreadedTree* tree, uint32_t index) : tree_(tree), index_(index) {}
+
+    const CompactThreadedTree* tree_ = nullptr;
+    uint32_t index_ = nil;
+  };
+
+public:
+  using key_type    = KeyT;
+  using mapped_type = ValueT;
+  using value_type  = std::pair<const KeyT, ValueT>;
+  using key_compare = CompT;
+
+  using iterator       = ConstIterator;
+  using const_iterator = ConstIterator;
+
+  using reverse_iterator       = std::reverse_iterator<const_iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  using allocator_type = AllocT;
+
+  CompactThreadedTree() : CompactThreadedTree(AllocT()) {}
+
+  explicit CompactThreadedTree(const AllocT& alloc) : nodes_(NodeAlloc(alloc)) {}
+
+  size_t size() const { return nodes_.size(); }
+
+  size_t max_size() const { return nil; }
+
+  bool empty() const { return nodes_.empty(); }
+
+  // Память под count узлов выделяется сразу: без нее вектор растет удвоением
+  void reserve(size_t count) { nodes_.reserve(count); }
+
+  void clear() {
+    nodes_.clear();
+    root_ = nil;
+  }
+
+  const_iterator begin() const { return const_iterator(this, left_most(root_)); }
+  const_iterator end()   const { return const_iterator(this, nil); }
+
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend()   const { return end(); }
+
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend()   const { return const_reverse_iterator(begin()); }
+
+  const_iterator find(const KeyT& key) const {
+    uint32_t node = root_;
+    while (node != nil) {
+      const Node& cur = nodes_[node];
+      if (comp_(key, cur.data.first)) {
+        node = down(cur.left);
+      } else if (comp_(cur.data.first, key)) {
+        node = down(cur.right);
+      } else {
+        return const_iterator(this, node);
+      }
+    }
+    return end();
+  }
+
+  bool contains(const KeyT& key) const { return find(key) != end(); }
+
+  const ValueT& at(const KeyT& key) const {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("Key not found in the tree");
+    }
+    return it->second;
+  }
+
+  // Вставка, если ключа еще нет. Узел добавляется в конец вектора, путь от корня
+  // запоминается при спуске и на подъеме по нему пересчитываются размеры и высоты
+  std::pair<const_iterator, bool> insert(const KeyT& key, const ValueT& value) {
+    if (root_ == nil) {
+      root_ = create_node(key, value, thread(nil), thread(nil));
+      assert(validate(&std::cerr));
+      return {const_iterator(this, root_), true};
+    }
+
+    std::array<uint32_t, max_height> path;
+    std::array<bool, max_height> went_left;
+    size_t depth = 0;
+
+    for (uint32_t node = root_; node != nil; ) {
+      const Node& cur = nodes_[node];
+      path[depth] = node;
+      if (comp_(key, cur.data.first)) {
+        went_left[depth++] = true;
+        node = down(cur.left);
+      } else if (comp_(cur.data.first, key)) {
+        went_left[depth++] = false;
+        node = down(cur.right);
+      } else {
+        return {const_iterator(this, node), false};
+      }
+    }
+
+    if (size() == max_size()) {
+      throw std::length_error("CompactThreadedTree size exceeds max_size()");
+    }
+
+    // Новый лист забирает нить родителя со своей стороны, а на другой стороне
+    // получает нить к самому родителю
+    uint32_t parent = path[depth - 1];
+    uint32_t new_node = 0;
+    if (went_left[depth - 1]) {
+      new_node = create_node(key, value, nodes_[parent].left, thread(parent));
+      nodes_[parent].left = child(new_node);
+    } else {
+      new_node = create_node(key, value, thread(parent), nodes_[parent].right);
+      nodes_[parent].right = child(new_node);
+    }
+
+    for (size_t i = depth; i-- > 0; ) {
+      uint32_t sub = balance(path[i]);
+      if (i == 0) {
+        root_ = sub;
+      } else if (went_left[i - 1]) {
+        nodes_[path[i - 1]].left = child(sub);
+      } else {
+        nodes_[path[i - 1]].right = child(sub);
+      }
+    }
+
+    assert(validate(&std::cerr));
+    return {const_iterator(this, new_node), true};
+  }
+
+  // first not less than key
+  const_iterator lower_bound(const KeyT& key) const {
+    return const_iterator(this, find_bound(key, /* upper = */ false));
+  }
+
+  // first greater than key
+  const_iterator upper_bound(const KeyT& key) const {
+    return const_iterator(this, find_bound(key, /* upper = */ true));
+  }
+
+  // Число элементов строго меньше key, O(log n)
+  size_t rank(const KeyT& key) const {
+    return count_before(key, /* upper = */ false);
+  }
+
+  // Число элементов в [lo, hi], O(log n)
+  size_t count_range(const KeyT& lo, const KeyT& hi) const {
+    if (comp_(hi, lo)) { return 0; }
+    return count_before(hi, /* upper = */ true) - count_before(lo, /* upper = */ false);
+  }
+
+private:
+  static Link child(uint32_t index)  { return index << 1; }
+  static Link thread(uint32_t index) { return (index << 1) | 1; }
+
+  static bool is_thread(Link link) { return (link & 1) != 0; }
+  static uint32_t target(Link link) { return link >> 1; }
+
+  // Ребенок по ссылке или nil, если это нить
+  static uint32_t down(Link link) { return is_thread(link) ? nil : target(link); }
+
+  uint32_t create_node(const KeyT& key, const ValueT& value, Link left, Link right) {
+    nodes_.push_back(Node{{key, value}, left, right, 1, 1});
+    return static_cast<uint32_t>(nodes_.size() - 1);
+  }
+
+  uint32_t left_most(uint32_t node) const {
+    if (node == nil) { return nil; }
+    while (!is_thread(nodes_[node].left)) { node = target(nodes_[node].left); }
+    return node;
+  }
+
+  uint32_t right_most(uint32_t node) const {
+    if (node == nil) { return nil; }
+    while (!is_thread(nodes_[node].right)) { node = target(nodes_[node].right); }
+    return node;
+  }
+
+  int height(Link link) const {
+    return is_thread(link) ? 0 : nodes_[target(link)].height;
+  }
+
+  uint32_t subtree_size(Link link) const {
+    return is_thread(link) ? 0 : nodes_[target(link)].size;
+  }
+
+  void fix(uint32_t node) {
+    Node& cur = nodes_[node];
+    cur.height = static_cast<uint8_t>(std::max(height(cur.left), height(cur.right)) + 1);
+    cur.size   = subtree_size(cur.left) + subtree_size(cur.right) + 1;
+  }
+
+  // Если у левого ребенка нет правого поддерева, на его месте у node остается
+  // нить к самому ребенку - он становится предшественником node
+  uint32_t rotate_right(uint32_t node) {
+    uint32_t left = target(nodes_[node].left);
+    Link moved = nodes_[left].right;
+    nodes_[node].left  = is_thread(moved) ? thread(left) : moved;
+    nodes_[left].right = child(node);
+    fix(node);
+    fix(left);
+    return left;
+  }
+
+  uint32_t rotate_left(uint32_t node) {
+    uint32_t right = target(nodes_[node].right);
+    Link moved = nodes_[right].left;
+    nodes_[node].right = is_thread(moved) ? thread(right) : moved;
+    nodes_[right].left = child(node);
+    fix(node);
+    fix(right);
+    return right;
+  }
+
+  // Пересчет узла и AVL-балансировка; возвращает новый корень поддерева
+  uint32_t balance(uint32_t node) {
+    fix(node);
+    int diff = height(nodes_[node].left) - height(nodes_[node].right);
+    if (diff > 1) {
+      uint32_t left = target(nodes_[node].left);
+      if (height(nodes_[left].left) < height(nodes_[left].right)) {
+        nodes_[node].left = child(rotate_left(left));
+      }
+      return rotate_right(node);
+    }
+    if (diff < -1) {
+      uint32_t right = target(nodes_[node].right);
+      if (height(nodes_[right].right) < height(nodes_[right].left)) {
+        nodes_[node].right = child(rotate_right(right));
+      }
+      return rotate_left(node);
+    }
+    return node;
+  }
+
+  // upper = false: первый узел с ключом не меньше key, upper = true: первый больше key
+  uint32_t find_bound(const KeyT& key, bool upper) const {
+    uint32_t res = nil;
+    for (uint32_t node = root_; node != nil; ) {
+      const Node& cur = nodes_[node];
+      bool go_right = upper ? !comp_(key, cur.data.first) : comp_(cur.data.first, key);
+      if (go_right) {
+        node = down(cur.right);
+      } else {
+        res = node;
+        node = down(cur.left);
+      }
+    }
+    return res;
+  }
+
+  // Число узлов левее find_bound(key, upper)
+  size_t count_before(const KeyT& key, bool upper) const {
+    size_t res = 0;
+    for (uint32_t node = root_; node != nil; ) {
+      const Node& cur = nodes_[node];
+      bool go_right = upper ? !comp_(key, cur.data.first) : comp_(cur.data.first, key);
+      if (go_right) {
+        res += subtree_size(cur.left) + 1;
+        node = down(cur.right);
+      } else {
+        node = down(cur.left);
+      }
+    }
+    return res;
+  }
+
+  // Проверка порядка, нитей, размеров, высот и AVL-баланса
+  bool validate(std::ostream* err) const {
+    auto fail = [err](const char* what) {
+      if (err) { *err << "validate failed: " << what << std::endl; }
+      return false;
+    };
+
+    if (root_ == nil) { return nodes_.empty() || fail("lost nodes"); }
+    if (nodes_[root_].size != nodes_.size()) { return fail("root size mismatch"); }
+
+    uint32_t prev = nil;
+    size_t visited = 0;
+    for (uint32_t node = left_most(root_); node != nil; ++visited) {
+      if (visited == nodes_.size()) { return fail("thread cycle"); }
+      const Node& cur = nodes_[node];
+      if (prev != nil && !comp_(nodes_[prev].data.first, cur.data.first)) { return fail("order"); }
+      if (is_thread(cur.left) && target(cur.left) != prev) { return fail("left thread"); }
+      if (cur.size != subtree_size(cur.left) + subtree_size(cur.right) + 1) { return fail("size"); }
+      if (cur.height != std::max(height(cur.left), height(cur.right)) + 1) { return fail("height"); }
+      if (std::abs(height(cur.left) - height(cur.right)) > 1) { return fail("balance"); }
+
+      prev = node;
+      node = is_thread(cur.right) ? target(cur.right) : left_most(target(cur.right));
+    }
+    if (visited != nodes_.size()) { return fail("unreachable nodes"); }
+    return prev == right_most(root_) || fail("right thread");
+  }
+
+  std::vector<Node, NodeAlloc> nodes_;
+  uint32_t root_ = nil;
+  CompT comp_{};
+};
+
+} // namespace myds
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <bit>
+#include <limits>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+#include <functional>
+
+namespace myds {
+
+// Неизменяемый снимок отсортированного отображения для фаз только чтения.
+// Ключи лежат в порядке Eytzinger (неявная куча в BFS-порядке): первые уровни
+// поиска собраны в начале массива, а потомки узла k на 4 уровня ниже занимают
+// 16 подряд идущих ячеек начиная с 16k, поэтому их можно подгрузить заранее.
+// Спуск без ветвлений: k = 2k + (key_k < x).
+template<typename KeyT, typename ValueT, typename CompT = std::less<KeyT>>
+class EytzingerSnapshot {
+public:
+  using value_type = std::pair<KeyT, ValueT>;
+  using size_type  = size_t;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  EytzingerSnapshot() : keys_(1), ranks_(1, 0) {}
+
+  // items - строго возрастающие по ключу пары
+  explicit EytzingerSnapshot(std::vector<value_type> items, CompT comp = CompT())
+    : items_(std::move(items)), keys_(items_.size() + 1), ranks_(items_.size() + 1), comp_(comp) {
+    if (items_.size() >= std::numeric_limits<uint32_t>::max()) {
+      throw std::length_error("EytzingerSnapshot: too many elements");
+    }
+    size_t next = 0;
+    fill(1, next);
+    ranks_[0] = static_cast<uint32_t>(items_.size());
+  }
+
+  size_t size() const { return items_.size(); }
+
+  bool empty() const { return items_.empty(); }
+
+  // Элементы в порядке возрастания ключа
+  const_iterator begin() const { return items_.begin(); }
+  const_iterator end()   const { return items_.end(); }
+
+  const value_type& operator[](size_t pos) const { return items_[pos]; }
+
+  // Позиция первого элемента >= key в порядке возрастания (size(), если такого нет)
+  size_t lower_bound(const KeyT& key) const {
+    return search</* Upper = */ false>(key);
+  }
+
+  // Позиция первого элемента > key
+  size_t upper_bound(const KeyT& key) const {
+    return search</* Upper = */ true>(key);
+  }
+
+  // Число элементов в [lo, hi]
+  size_t count_range(const KeyT& lo, const KeyT& hi) const {
+    if (comp_(hi, lo)) { return 0; }
+    return upper_bound(hi) - lower_bound(lo);
+  }
+
+  const ValueT* find(const KeyT& key) const {
+    size_t pos = lower_bound(key);
+    if (pos == size() || comp_(key, items_[pos].first)) { return nullptr; }
+    return &items_[pos].second;
+  }
+
+private:
+  // Раскладка отсортированных элементов по узлам неявного дерева обходом inorder
+  void fill(size_t k, size_t& next) {
+    if (k >= keys_.size()) { return; }
+    fill(2 * k, next);
+    keys_[k]  = items_[next].first;
+    ranks_[k] = static_cast<uint32_t>(next);
+    ++next;
+    fill(2 * k + 1, next);
+  }
+
+  template<bool Upper>
+  size_t search(const KeyT& key) const {
+    const size_t n = keys_.size();
+    const KeyT* keys = keys_.data();
+
+    size_t k = 1;
+    while (k < n) {
+#if defined(__GNUC__)
+      __builtin_prefetch(keys + 16 * k);
+#endif
+      bool go_right = Upper ? !comp_(key, keys[k]) : comp_(keys[k], key);
+      k = 2 * k + static_cast<size_t>(go_right);
+    }
+
+    // Путь заканчивается за листом; последний поворот налево указывает на ответ.
+    // Снимаем хвост из единиц (повороты направо) и сам этот поворот
+    k >>= std::countr_one(k) + 1;
+    return ranks_[k];
+  }
+
+  std::vector<value_type> items_;
+  std::vector<KeyT> keys_;        // keys_[0] не используется
+  std::vector<uint32_t> ranks_;   // позиция keys_[k] в порядке возрастания; ranks_[0] = size()
+  CompT comp_;
+};
+
+} // namespace myds
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <concepts>
+
+namespace rq {
+
+// Буферизованное чтение команд: поток читается блоками через streambuf,
+// числа разбираются std::from_chars. Интерфейс повторяет нужную часть
+// std::istream (>> для char и int, проверка через bool), поэтому
+// RangeQuery работает с обоими
+class FastReader {
+public:
+  explicit FastReader(std::istream& in, size_t block = size_t{1} << 16)
+    : in_(in), buf_(block + LOOKAHEAD), pos_(buf_.data()), end_(buf_.data()) {}
+
+  FastReader& operator>>(char& c) {
+    if (!skip_spaces()) { return *this; }
+    c = *pos_++;
+    return *this;
+  }
+
+  FastReader& operator>>(int& x) {
+    if (!skip_spaces()) { return *this; }
+    char* last = number_end();
+
+    // Как и istream, принимаем явный плюс; from_chars его не разбирает
+    char* first = pos_;
+    if (*first == '+' && first + 1 != last) { ++first; }
+
+    auto [ptr, ec] = std::from_chars(first, last, x);
+    if (ec != std::errc()) {
+      ok_ = false;
+      return *this;
+    }
+    pos_ += ptr - pos_;
+    return *this;
+  }
+
+  explicit operator bool() const { return ok_; }
+
+private:
+  // Запас под обычное число: int без ведущих нулей занимает не больше 11 символов
+  static constexpr size_t LOOKAHEAD = 32;
+
+  static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+  static bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  // Пропускает пробелы; false (и ошибка потока), если данные кончились
+  bool skip_spaces() {
+    if (!ok_) { return false; }
+    while (true) {
+      while (pos_ != end_ && is_space(*pos_)) { ++pos_; }
+      if (pos_ != end_) { return true; }
+      if (eof_) {
+        ok_ = false;
+        return false;
+      }
+      fill(1);
+    }
+  }
+
+  // Конец записи числа у pos_ (знак и цифры). Пока запись упирается в конец буфера,
+  // поток дочитывается, а при нужде буфер растет: длинное число (например, с ведущими
+  // нулями) не должно рваться на границе блока
+  char* number_end() {
+    fill(LOOKAHEAD);
+    size_t len = (*pos_ == '+' || *pos_ == '-') ? 1 : 0;
+    while (true) {
+      while (pos_ + len != end_ && is_digit(pos_[len])) { ++len; }
+      if (pos_ + len != end_ || eof_) { return pos_ + len; }
+      if (len == buf_.size()) { grow(); }
+      fill(len + 1);
+    }
+  }
+
+  void grow() {
+    size_t pos = static_cast<size_t>(pos_ - buf_.data());
+    size_t end = static_cast<size_t>(end_ - buf_.data());
+    buf_.resize(buf_.size() * 2);
+    pos_ = buf_.data() + pos;
+    end_ = buf_.data() + end;
+  }
+
+  // Дочитывает поток, пока в буфере меньше need символов и он не кончился
+  void fill(size_t need) {
+    size_t left = static_cast<size_t>(end_ - pos_);
+    if (left >= need || eof_) { return; }
+
+    std::memmove(buf_.data(), pos_, left);
+    pos_ = buf_.data();
+    end_ = pos_ + left;
+
+    while (static_cast<size_t>(end_ - pos_) < need && !eof_) {
+      auto got = in_.rdbuf()->sgetn(end_, static_cast<std::streamsize>(buf_.data() + buf_.size() - end_));
+      if (got <= 0) {
+        eof_ = true;
+      } else {
+        end_ += got;
+      }
+    }
+  }
+
+  std::istream& in_;
+  std::vector<char> buf_;
+  char* pos_;
+  char* end_;
+  bool eof_{false};
+  bool ok_{true};
+};
+
+// Буферизованный вывод: числа форматируются std::to_chars в буфер,
+// в поток он уходит целиком при заполнении, flush() или в деструкторе
+class FastWriter {
+public:
+  explicit FastWriter(std::ostream& out, size_t block = size_t{1} << 16)
+    : out_(out), buf_(std::max(block, MAX_NUMBER)) {}
+
+  FastWriter(const FastWriter&) = delete;
+  FastWriter& operator=(const FastWriter&) = delete;
+
+  ~FastWriter() { flush(); }
+
+  template<std::integral T>
+  FastWriter& operator<<(T x) {
+    reserve(MAX_NUMBER);
+    pos_ = std::to_chars(buf_.data() + pos_, buf_.data() + buf_.size(), x).ptr - buf_.data();
+    return *this;
+  }
+
+  FastWriter& operator<<(char c) {
+    reserve(1);
+    buf_[pos_++] = c;
+    return *this;
+  }
+
+  FastWriter& operator<<(const char* str) {
+    size_t len = std::strlen(str);
+    if (len > buf_.size()) {
+      flush();
+      out_.write(str, static_cast<std::streamsize>(len));
+      return *this;
+    }
+    reserve(len);
+    std::memcpy(buf_.data() + pos_, str, len);
+    pos_ += len;
+    return *this;
+  }
+
+  void flush() {
+    if (pos_ == 0) { return; }
+    out_.write(buf_.data(), static_cast<std::streamsize>(pos_));
+    out_.flush();
+    pos_ = 0;
+  }
+
+private:
+  // Достаточно для любого 64-битного целого со знаком
+  static constexpr size_t MAX_NUMBER = 24;
+
+  void reserve(size_t len) {
+    if (buf_.size() - pos_ < len) { flush(); }
+  }
+
+  std::ostream& out_;
+  std::vector<char> buf_;
+  size_t pos_{0};
+};
+
+} // namespace rq
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <utility>
+#include <variant>
+#include <cstddef>
+#include <stdexcept>
+#include <functional>
+
+#include "tree.hpp"
+
+namespace myds {
+
+// Множество отрезков [lo, hi] (концы включаются) с поиском пересечений с запросом [l, r].
+// Хранится в ThreadedBinaryTree с ключом (lo, hi) и агрегатом MaxEndAggregate:
+// каждый узел знает максимальный правый конец в своем поддереве.
+//
+// Пересекаются [l, r] отрезки с lo <= r и hi >= l. Первый такой отрезок в порядке
+// ключей находится спуском за O(log n) с отсечением поддеревьев, где максимум концов
+// меньше l. Следующий сначала проверяется по нити (сосед по ключу) за O(1), иначе
+// ищется тем же спуском из правого поддерева и предков. Итого O(log n + k), если
+// пересечения идут подряд по началам (типичный случай коротких отрезков), и
+// O((k + 1) log n) в худшем случае, когда между ними много непересекающихся
+template<typename T, typename ValueT = std::monostate, typename BalanceT = AvlBalance>
+class IntervalTree {
+public:
+  using interval_type  = std::pair<T, T>;
+  using tree_type      = ThreadedBinaryTree<interval_type, ValueT, std::less<interval_type>,
+                                            MaxEndAggregate<T>, BalanceT>;
+  using value_type     = typename tree_type::value_type;
+  using const_iterator = typename tree_type::const_iterator;
+
+  // false, если такой отрезок уже есть
+  bool insert(const T& lo, const T& hi, const ValueT& value = ValueT{}) {
+    if (hi < lo) { throw std::invalid_argument("IntervalTree: interval end is less than its start"); }
+    return tree_.insert(interval_type(lo, hi), value).second;
+  }
+
+  bool remove(const T& lo, const T& hi) {
+    return tree_.remove(interval_type(lo, hi));
+  }
+
+  size_t size() const { return tree_.size(); }
+  bool empty() const { return tree_.empty(); }
+
+  // Обход в порядке (начало, конец)
+  const_iterator begin() const { return tree_.begin(); }
+  const_iterator end() const { return tree_.end(); }
+
+  // fn(const value_type&) для каждого отрезка, пересекающего [l, r], в порядке ключей
+  template<typename F>
+  void for_each_overlap(const T& l, const T& r, F fn) const {
+    if (r < l) { return; }
+    for (const Node* node = first_overlap(tree_.root_, l, r); node != nullptr;
+         node = next_overlap(node, l, r)) {
+      fn(node->data);
+    }
+  }
+
+  size_t count_overlaps(const T& l, const T& r) const {
+    size_t res = 0;
+    for_each_overlap(l, r, [&](const value_type&) { ++res; });
+    return res;
+  }
+
+  // Есть ли хоть один пересекающий отрезок, O(log n)
+  bool overlaps(const T& l, const T& r) const {
+    return !(r < l) && first_overlap(tree_.root_, l, r) != nullptr;
+  }
+
+private:
+  using Node = typename tree_type::Node;
+
+  static const T& start(const Node* node) { return node->data.first.first; }
+  static const T& finish(const Node* node) { return node->data.first.second; }
+
+  // В поддереве есть отрезок с концом >= l
+  static bool reaches(const Node* node, const T& l) {
+    return node != nullptr && node->agg && !(*node->agg < l);
+  }
+
+  static bool intersects(const Node* node, const T& l, const T& r) {
+    return !(r < start(node)) && !(finish(node) < l);
+  }
+
+  // Первый в порядке ключей отрезок поддерева, пересекающий [l, r].
+  // Спуск идет к самому левому узлу с концом >= l; если его начало больше r,
+  // то и у всех правее тоже
+  const Node* first_overlap(const Node* node, const T& l, const T& r) const {
+    if (!reaches(node, l)) { return nullptr; }
+    while (true) {
+      const Node* left = tree_.left_ptr(node);
+      if (reaches(left, l)) {
+        node = left;
+        continue;
+      }
+      if (r < start(node)) { return nullptr; }
+      if (!(finish(node) < l)) { return node; }
+
+      node = tree_.right_ptr(node);
+      if (!reaches(node, l)) { return nullptr; }
+    }
+  }
+
+  const Node* next_overlap(const Node* node, const T& l, const T& r) const {
+    // Сосед по нити: при коротких отрезках обычно он и есть следующий ответ
+    const Node* succ = node->right_th ? node->right : tree_type::left_most(node->right);
+    if (succ == tree_.sentinel_ || r < start(succ)) { return nullptr; }
+    if (intersects(succ, l, r)) { return succ; }
+
+    // Иначе: правое поддерево, затем предки, в чьем левом поддереве мы находимся,
+    // и их правые поддеревья
+    if (const Node* res = first_overlap(tree_.right_ptr(node), l, r)) { return res; }
+    for (; node->parent != nullptr; node = node->parent) {
+      const Node* parent = node->parent;
+      if (tree_.left_ptr(parent) != node) { continue; }
+      if (r < start(parent)) { return nullptr; }
+      if (intersects(parent, l, r)) { return parent; }
+      if (const Node* res = first_overlap(tree_.right_ptr(parent), l, r)) { return res; }
+    }
+    return nullptr;
+  }
+
+  tree_type tree_;
+};
+
+} // namespace myds
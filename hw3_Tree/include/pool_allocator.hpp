@@ -0,0 +1,234 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <memory_resource>
+
+namespace myds {
+
+namespace detail {
+
+// Владелец кусков памяти группы пулов, обменявшихся узлами.
+// Группы объединяются как в системе непересекающихся множеств: при слиянии куски
+// переходят корню, а поглощенная группа ссылается на него через parent_.
+// Ссылки идут только к корню, поэтому циклов владения не бывает, а повторное
+// слияние пулов одной группы ничего не делает. Куски освобождаются вместе с
+// корнем, то есть когда умирает последний пул всех слитых групп; каждый кусок
+// возвращается тому memory_resource, из которого взят
+class PoolLineage {
+public:
+  PoolLineage() = default;
+
+  PoolLineage(const PoolLineage&) = delete;
+  PoolLineage& operator=(const PoolLineage&) = delete;
+
+  ~PoolLineage() {
+    for (const Chunk& chunk : chunks_) {
+      chunk.upstream->deallocate(chunk.ptr, chunk.bytes, chunk.align);
+    }
+  }
+
+  // Корень группы; путь до него сжимается
+  static std::shared_ptr<PoolLineage> find(std::shared_ptr<PoolLineage>& lineage) {
+    if (lineage->parent_ == nullptr) { return lineage; }
+    lineage->parent_ = find(lineage->parent_);
+    lineage = lineage->parent_;
+    return lineage;
+  }
+
+  // Объединяет группы a и b; a и b после вызова указывают на общий корень
+  static void unite(std::shared_ptr<PoolLineage>& a, std::shared_ptr<PoolLineage>& b) {
+    std::shared_ptr<PoolLineage> root  = find(a);
+    std::shared_ptr<PoolLineage> other = find(b);
+    if (root == other) { return; }
+
+    if (root->chunks_.size() < other->chunks_.size()) { std::swap(root, other); }
+    root->chunks_.reserve(root->chunks_.size() + other->chunks_.size());
+    root->chunks_.insert(root->chunks_.end(), other->chunks_.begin(), other->chunks_.end());
+    other->chunks_.clear();
+    other->parent_ = root;
+    a = root;
+    b = root;
+  }
+
+  void* allocate_chunk(std::pmr::memory_resource* upstream, size_t bytes, size_t align) {
+    chunks_.reserve(chunks_.size() + 1);
+    void* ptr = upstream->allocate(bytes, align);
+    chunks_.push_back({ptr, bytes, align, upstream});
+    return ptr;
+  }
+
+private:
+  struct Chunk {
+    void* ptr;
+    size_t bytes;
+    size_t align;
+    std::pmr::memory_resource* upstream;
+  };
+
+  std::vector<Chunk> chunks_;
+  std::shared_ptr<PoolLineage> parent_;
+};
+
+// Пул блоков одного размера. Размер блока фиксируется первым запросом,
+// память берется кусками растущего размера, освобожденные блоки образуют
+// free list. Куски берутся у upstream, принадлежат группе пулов (PoolLineage)
+// и возвращаются все разом, когда умирает последний пул группы.
+class NodePool {
+public:
+  explicit NodePool(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+    : upstream_(upstream) {}
+
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  // Обслуживает ли пул блоки такого размера (первый вызов привязывает пул к размеру)
+  bool fits(size_t bytes, size_t align) {
+    if (block_size_ == 0) {
+      block_align_ = std::max(align, alignof(FreeBlock));
+      block_size_  = round_up(std::max(bytes, sizeof(FreeBlock)), block_align_);
+      request_size_ = bytes;
+    }
+    return bytes == request_size_ && align <= block_align_;
+  }
+
+  void* allocate() {
+    if (free_list_ != nullptr) {
+      FreeBlock* block = free_list_;
+      free_list_ = block->next;
+      return block;
+    }
+
+    if (cur_ == end_) { grow(); }
+
+    void* res = cur_;
+    cur_ += block_size_;
+    return res;
+  }
+
+  void deallocate(void* ptr) noexcept {
+    auto* block = static_cast<FreeBlock*>(ptr);
+    block->next = free_list_;
+    free_list_  = block;
+  }
+
+  // Объединяет группы пулов: память other живет, пока жив хоть один из них,
+  // и блоки other можно освобождать сюда. Порядок и повторы вызовов не важны
+  void adopt(NodePool& other) {
+    PoolLineage::unite(lineage_, other.lineage_);
+  }
+
+  std::pmr::memory_resource* upstream() const { return upstream_; }
+
+private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  static constexpr size_t min_chunk_blocks_ = 32;
+  static constexpr size_t max_chunk_blocks_ = size_t{1} << 16;
+
+  static size_t round_up(size_t x, size_t align) {
+    return (x + align - 1) / align * align;
+  }
+
+  void grow() {
+    size_t bytes = next_chunk_blocks_ * block_size_;
+    cur_ = static_cast<std::byte*>(PoolLineage::find(lineage_)->allocate_chunk(upstream_, bytes, block_align_));
+    end_ = cur_ + bytes;
+
+    next_chunk_blocks_ = std::min(next_chunk_blocks_ * 2, max_chunk_blocks_);
+  }
+
+  size_t block_size_{0};
+  size_t block_align_{alignof(FreeBlock)};
+  size_t request_size_{0};
+  size_t next_chunk_blocks_{min_chunk_blocks_};
+
+  std::byte* cur_{nullptr};
+  std::byte* end_{nullptr};
+  FreeBlock* free_list_{nullptr};
+  std::pmr::memory_resource* upstream_;
+  std::shared_ptr<PoolLineage> lineage_{std::make_shared<PoolLineage>()};
+};
+
+} // namespace detail
+
+// Аллокатор узлов дерева поверх detail::NodePool.
+// Копии аллокатора (и rebind) разделяют один пул; пул живет, пока жива хоть одна копия.
+// Память берется у upstream (по умолчанию - std::pmr::new_delete_resource()), туда же
+// уходят запросы не на один объект или другого размера. Не потокобезопасен.
+template <typename T>
+class PoolAllocator {
+public:
+  using value_type = T;
+
+  // Узлы можно не освобождать по одному: память вернется вместе с пулом
+  using releases_in_bulk = std::true_type;
+
+  // Копия контейнера получает собственный пул
+  using propagate_on_container_swap            = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+
+  PoolAllocator() : PoolAllocator(std::pmr::new_delete_resource()) {}
+
+  explicit PoolAllocator(std::pmr::memory_resource* upstream)
+    : pool_(std::make_shared<detail::NodePool>(upstream)) {}
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& other) noexcept : pool_(other.pool_) {}
+
+  PoolAllocator select_on_container_copy_construction() const {
+    return PoolAllocator(pool_->upstream());
+  }
+
+  T* allocate(size_t n) {
+    if (n == 1 && pool_->fits(sizeof(T), alignof(T))) {
+      return static_cast<T*>(pool_->allocate());
+    }
+    return static_cast<T*>(pool_->upstream()->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) noexcept {
+    if (n == 1 && pool_->fits(sizeof(T), alignof(T))) {
+      pool_->deallocate(ptr);
+      return;
+    }
+    pool_->upstream()->deallocate(ptr, n * sizeof(T), alignof(T));
+  }
+
+  // Объекты, выделенные other, можно освобождать через *this
+  template <typename U>
+  void adopt(const PoolAllocator<U>& other) {
+    pool_->adopt(*other.pool_);
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>& other) const noexcept {
+    return pool_ == other.pool_;
+  }
+
+private:
+  template <typename U>
+  friend class PoolAllocator;
+
+  std::shared_ptr<detail::NodePool> pool_;
+};
+
+// true, если аллокатор объявляет releases_in_bulk: контейнеру достаточно
+// вызвать деструкторы, а память узлов освободит сам аллокатор
+template <typename Alloc, typename = void>
+struct releases_in_bulk : std::false_type {};
+
+template <typename Alloc>
+struct releases_in_bulk<Alloc, std::void_t<typename Alloc::releases_in_bulk>>
+  : Alloc::releases_in_bulk {};
+
+template <typename Alloc>
+inline constexpr bool releases_in_bulk_v = releases_in_bulk<Alloc>::value;
+
+} // namespace myds
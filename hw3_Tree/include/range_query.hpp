@@ -1,44 +1,138 @@
 #pragma once
 
-#include <iterator>
+#include <utility>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 
 namespace rq {
 
+// Дерево, агрегирующее пару (сумма, максимум): только на нем доступны команды s и m
+template <typename TreeT>
+concept SumMaxTree = requires(const TreeT& tree) {
+  static_cast<long long>(tree.aggregate(0, 0).first);
+  static_cast<long long>(*tree.aggregate(0, 0).second);
+};
+
+// In/Out - std::istream/std::ostream или rq::FastReader/rq::FastWriter
 template <typename TreeT>
 class RangeQuery {
 public:
-  static void process_command(TreeT& tree, char command, std::istream& in, std::ostream& out) {
+  template <typename In, typename Out>
+  static void process_command(TreeT& tree, char command, In& in, Out& out) {
     switch (command) {
       case 'k': handle_insert(tree, in); break;
-      case 'q': handle_query(tree, in, out); break;
+      case 'q': handle_range(tree, command, in, out); break;
+      case 's':
+      case 'm':
+        if constexpr (SumMaxTree<TreeT>) {
+          handle_range(tree, command, in, out);
+          break;
+        }
+        [[fallthrough]];
       default:
           throw std::invalid_argument("Unknown command");
     }
   }
 
-private:
-  static void handle_insert(TreeT& tree, std::istream& in) {
-    int key = 0;
-    if (!(in >> key)) { throw std::runtime_error("Failed to read key"); }
-    tree.insert(key, key);
+  // Обрабатывает команды до конца потока или команды 'e', начиная с уже прочитанной
+  // command (если она не '\0'). Возвращает команду s/m, которую дерево без агрегата
+  // решить не может (ее границы еще не прочитаны), иначе '\0'
+  template <typename In, typename Out>
+  static char run(TreeT& tree, In& in, Out& out, char command = '\0') {
+    for (bool have = command != '\0' || (in >> command); have && command != 'e';
+         have = static_cast<bool>(in >> command)) {
+      if (needs_aggregate(command)) { return command; }
+      process_command(tree, command, in, out);
+    }
+    return '\0';
+  }
+
+  static bool is_range_command(char command) {
+    return command == 'q' || command == 's' || command == 'm';
   }
 
-  static void handle_query(TreeT& tree, std::istream& in, std::ostream& out) {
+  static bool needs_aggregate(char command) {
+    return !SumMaxTree<TreeT> && (command == 's' || command == 'm');
+  }
+
+  // Ответ на q/s/m по [L, R]; std::nullopt - максимум пустого диапазона.
+  // s и m требуют SumMaxTree. При R <= L диапазон считается пустым
+  static std::optional<long long> answer(const TreeT& tree, char command, int left_bound, int right_bound) {
+    bool empty = right_bound <= left_bound;
+    if (command == 'q') {
+      return empty ? 0 : static_cast<long long>(tree.count_range(left_bound, right_bound));
+    }
+    if constexpr (SumMaxTree<TreeT>) {
+      if (command == 's') {
+        return empty ? 0 : static_cast<long long>(tree.aggregate(left_bound, right_bound).first);
+      }
+      if (command == 'm') {
+        if (empty) { return std::nullopt; }
+        auto max = tree.aggregate(left_bound, right_bound).second;
+        return max ? std::optional<long long>(*max) : std::nullopt;
+      }
+    }
+    throw std::invalid_argument("Unknown command");
+  }
+
+  template <typename Out>
+  static void write_answer(Out& out, const std::optional<long long>& res) {
+    if (res) {
+      out << *res << ' ';
+    } else {
+      out << "none ";
+    }
+  }
+
+  template <typename In>
+  static std::pair<int, int> read_bounds(In& in) {
     int left_bound = 0;
     int right_bound = 0;
     if (!(in >> left_bound >> right_bound)) {
       throw std::runtime_error("Failed to read range bounds");
     }
-    
-    size_t count = 0;
-    if (right_bound <= left_bound) {
-      count = 0;
-    } else {
-      count = std::distance(tree.lower_bound(left_bound), tree.upper_bound(right_bound));
+    return {left_bound, right_bound};
+  }
+
+private:
+  template <typename In>
+  static void handle_insert(TreeT& tree, In& in) {
+    int key = 0;
+    if (!(in >> key)) { throw std::runtime_error("Failed to read key"); }
+    tree.insert(key, key);
+  }
+
+  // q L R - число ключей, s L R - сумма, m L R - максимум (none для пустого диапазона)
+  template <typename In, typename Out>
+  static void handle_range(TreeT& tree, char command, In& in, Out& out) {
+    auto [left_bound, right_bound] = read_bounds(in);
+    write_answer(out, answer(tree, command, left_bound, right_bound));
+  }
+};
+
+// Режим отрезков rq (--intervals), TreeT - myds::IntervalTree:
+//   i L R - добавить отрезок [L, R] (ошибка, если R < L)
+//   o L R - сколько добавленных отрезков пересекает [L, R] (концы включаются, при R < L ответ 0)
+template <typename TreeT>
+class IntervalQuery {
+public:
+  template <typename In, typename Out>
+  static void process_command(TreeT& tree, char command, In& in, Out& out) {
+    switch (command) {
+      case 'i': {
+        auto [left_bound, right_bound] = RangeQuery<TreeT>::read_bounds(in);
+        tree.insert(left_bound, right_bound);
+        break;
+      }
+      case 'o': {
+        auto [left_bound, right_bound] = RangeQuery<TreeT>::read_bounds(in);
+        RangeQuery<TreeT>::write_answer(out, static_cast<long long>(tree.count_overlaps(left_bound, right_bound)));
+        break;
+      }
+      default:
+          throw std::invalid_argument("Unknown command");
     }
-    out << count << ' ';
   }
 };
 
@@ -19,46 +19,91 @@ ThreadedBinaryTree - это реализация сбалансированно
    leftmost(root_)->left (поток) == sentinel_
    rightmost(root_)->right (поток) == sentinel_
 
-4) AVL: abs(balance_factor(node)) <= 1 и node->height согласованны.
+4) Баланс: node->height - ранг узла по правилам BalanceT (balance.hpp). Для AVL это высота,
+   abs(balance_factor(node)) <= 1.
+
+5) node->size - число узлов в поддереве node (для sentinel_ равно 0).
+
+6) node->agg - свертка AggT по поддереву node в порядке обхода.
 
 */
 
 #pragma once
 
+#include <bit>
+#include <array>
 #include <cmath>
+#include <future>
+#include <memory>
+#include <tuple>
+#include <thread>
+#include <vector>
 #include <cassert>
+#include <cstdint>
 #include <utility>
 #include <iostream>
 #include <optional>
 #include <stdexcept>
+#include <iterator>
+#include <exception>
+#include <algorithm>
+#include <concepts>
 #include <functional>
+#include <system_error>
+#include <type_traits>
 #include <unordered_map>
 
+#include "balance.hpp"
+#include "aggregate.hpp"
+#include "eytzinger.hpp"
+#include "pool_allocator.hpp"
+
 namespace myds {
 
-template<typename KeyT, typename ValueT, typename CompT = std::less<KeyT>>
+// Компаратор, сравнивающий ключ с произвольным типом (std::less<>, std::ranges::less и т.п.)
+template<typename CompT>
+concept TransparentCompare = requires { typename CompT::is_transparent; };
+
+template<
+  typename KeyT, typename ValueT, typename CompT = std::less<KeyT>,
+  typename AggT = NoAggregate,
+  typename BalanceT = AvlBalance,
+  typename AllocT = PoolAllocator<std::pair<const KeyT, ValueT>>
+>
 class ThreadedBinaryTree {
 private:
+  // Перечисление пересечений спускается по узлам, отсекая поддеревья по агрегату
+  template<typename, typename, typename> friend class IntervalTree;
+
+  using AggValue = typename AggT::result_type;
+
+  // При аугментации значение нельзя менять по ссылке (итератор, operator[], at()):
+  // агрегаты на пути к корню устарели бы. Для этого есть update()
+  static constexpr bool mutable_values = std::is_same_v<AggT, NoAggregate>;
+  using MappedRef = std::conditional_t<mutable_values, ValueT&, const ValueT&>;
+
   struct Node {
-    Node(
-      const KeyT& key, 
-      const ValueT& value, 
-      Node* left   = nullptr, 
-      Node* right  = nullptr, 
-      Node* parent = nullptr, 
-      bool left_th = true, bool right_th = true,
-      int height   = 1
-    ) : data(key, value), height(height), 
-        left(left), right(right), parent(parent), 
-        left_th(left_th), right_th(right_th) {}
+    // Пара строится прямо в узле из аргументов конструктора std::pair;
+    // связи заполняет дерево при вставке
+    template<typename... Args>
+    explicit Node(Args&&... args)
+      : data(std::forward<Args>(args)...), agg(AggT::lift(data.first, data.second)),
+        left(nullptr), right(nullptr), parent(nullptr),
+        size(1), height(1), left_th(true), right_th(true) {}
 
     std::pair<const KeyT, ValueT> data;
 
-    int height;
+    // Для NoAggregate места не занимает
+    [[no_unique_address]] AggValue agg;
 
     Node* left;
     Node* right;
     Node* parent;
+
+    // height - ранг узла (для AVL - высота); он меньше 2 * 64 при любой балансировке,
+    // ему хватает байта. Компактный узел - в CompactThreadedTree (compact_tree.hpp)
+    size_t  size;
+    uint8_t height;
     bool left_th, right_th;
   };
   
@@ -105,7 +150,7 @@ private:
     auto operator<=>(const ConstIterator& other) const = default;
 
   private:
-    friend class ThreadedBinaryTree<KeyT, ValueT, CompT>;
+    friend class ThreadedBinaryTree;
 
     const Node* next(const Node* n) const {
       if (n == nullptr) { return nullptr; }
@@ -125,8 +170,8 @@ private:
   class Iterator : public ConstIterator {
   public:
     using value_type = std::pair<const KeyT, ValueT>;
-    using pointer    = value_type*;
-    using reference  = value_type&;
+    using pointer    = std::conditional_t<mutable_values, value_type*, const value_type*>;
+    using reference  = std::conditional_t<mutable_values, value_type&, const value_type&>;
 
     explicit Iterator(Node* n = nullptr) : ConstIterator(n) {}
 
@@ -140,6 +185,9 @@ private:
   };
 
 public:
+  using key_type        = KeyT;
+  using mapped_type     = ValueT;
+  using key_compare     = CompT;
   using value_type      = std::pair<const KeyT, ValueT>;
   using size_type       = size_t;
   using difference_type = std::ptrdiff_t;
@@ -156,7 +204,13 @@ public:
   using reverse_iterator       = std::reverse_iterator<iterator>;
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-  ThreadedBinaryTree() : root_(nullptr), sentinel_(make_sentinel()), comp_(), size_(0) {
+  using allocator_type = AllocT;
+  using aggregate_type = AggValue;
+
+  ThreadedBinaryTree() : ThreadedBinaryTree(AllocT()) {}
+
+  explicit ThreadedBinaryTree(const AllocT& alloc)
+    : alloc_(alloc), root_(nullptr), sentinel_(make_sentinel()), comp_(), size_(0) {
     assert(validate(&std::cerr));
   }
 
@@ -166,10 +220,12 @@ public:
   }
 
   ThreadedBinaryTree(const ThreadedBinaryTree& rhs) : ThreadedBinaryTree() {
-    ThreadedBinaryTree<KeyT, ValueT, CompT> tmp;
+    ThreadedBinaryTree tmp{
+      std::allocator_traits<AllocT>::select_on_container_copy_construction(rhs.get_allocator())
+    };
     tmp.size_ = rhs.size_;
     tmp.comp_ = rhs.comp_;
-    tmp.root_ = rhs.copy();
+    tmp.root_ = rhs.copy(tmp);
     tmp.update_sentinel();
 
     swap_with(tmp);
@@ -193,12 +249,23 @@ public:
   
   ~ThreadedBinaryTree() {
     assert(validate(&std::cerr));
-    inorder([](Node* node) { delete node; });
-    delete sentinel_;
+    if constexpr (releases_in_bulk_v<AllocT>) {
+      // Память узлов вернет пул целиком, поэтому обход нужен только ради деструкторов
+      if constexpr (!std::is_trivially_destructible_v<Node>) {
+        inorder([this](Node* node) { NodeTraits::destroy(alloc_, node); });
+      }
+    } else {
+      inorder([this](Node* node) { destroy_node(node); });
+    }
+    destroy_node(sentinel_);
   }
 
+  allocator_type get_allocator() const { return allocator_type(alloc_); }
+
   size_t size() const { return size_; }
 
+  size_t max_size() const { return std::allocator_traits<NodeAlloc>::max_size(alloc_); }
+
   bool empty() const { return size_ == 0; }
 
   iterator begin() { return root_ ? iterator(left_most(root_)) : end(); }
@@ -219,16 +286,15 @@ public:
   const_reverse_iterator crbegin() const { return rbegin(); }
   const_reverse_iterator crend()   const { return rend(); }
 
-  ValueT& operator[](const KeyT& key) {
-    Node* node = find_node(key);
-    if (node == sentinel_) {
-      auto [it, ok] = insert(key, ValueT{});
-      return it->second;
-    }
-    return node->data.second;
+  MappedRef operator[](const KeyT& key) {
+    return try_emplace(key).first->second;
+  }
+
+  MappedRef operator[](KeyT&& key) {
+    return try_emplace(std::move(key)).first->second;
   }
 
-  ValueT& at(const KeyT& key) {
+  MappedRef at(const KeyT& key) {
     Node* node = find_node(key);
     if (node == sentinel_) {
       throw std::out_of_range("Key not found in the tree");
@@ -252,120 +318,145 @@ public:
     return const_iterator(find_node(key));
   }
 
+  // Гетерогенный поиск, как у std::map: если у CompT есть is_transparent, ключ может быть
+  // любого сравнимого с KeyT типа (например, std::string_view для std::string с std::less<>)
+  // и временный KeyT не создается
+  template<typename K> requires TransparentCompare<CompT>
+  iterator find(const K& key) {
+    return iterator(find_node(key));
+  }
+
+  template<typename K> requires TransparentCompare<CompT>
+  const_iterator find(const K& key) const {
+    return const_iterator(find_node(key));
+  }
+
+  template<typename K> requires TransparentCompare<CompT>
+  MappedRef at(const K& key) {
+    return const_cast<MappedRef>(std::as_const(*this).at(key));
+  }
+
+  template<typename K> requires TransparentCompare<CompT>
+  const ValueT& at(const K& key) const {
+    const Node* node = find_node(key);
+    if (node == sentinel_) {
+      throw std::out_of_range("Key not found in the tree");
+    }
+    return node->data.second;
+  }
+
   // Вставка нового узла в дерево
   std::pair<iterator, bool> insert(const KeyT& new_key, const ValueT& new_value) {
-    assert(validate(&std::cerr));
-    if (root_ == nullptr) {
-      root_ = new Node{new_key, new_value};
-      update_sentinel();
-      ++size_;
+    return try_emplace(new_key, new_value);
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return emplace(value);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return emplace(std::move(value));
+  }
+
+  // Вставка с подсказкой: если ключ встает рядом с hint (прямо перед или после него),
+  // место находится за O(1) через нити без спуска от корня. Для потока возрастающих
+  // ключей подходит hint = end(). Иначе - обычная вставка
+  iterator insert(const_iterator hint, const KeyT& new_key, const ValueT& new_value) {
+    return try_emplace(hint, new_key, new_value);
+  }
+
+  // Аргументы - как у конструктора value_type (в том числе std::piecewise_construct).
+  // Если ключ виден среди аргументов, узел создается только после поиска места
+  template<typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    if constexpr (key_is_first_arg<Args...>()) {
+      const auto& key = std::get<0>(std::forward_as_tuple(args...));
+      return emplace_with_key(key, std::forward<Args>(args)...);
+    } else if constexpr (key_is_pair_arg<Args...>()) {
+      const auto& key = std::get<0>(std::forward_as_tuple(args...)).first;
+      return emplace_with_key(key, std::forward<Args>(args)...);
+    } else {
       assert(validate(&std::cerr));
-      return {iterator(root_), true};
-    }
-    
-    Node* cur_node = root_;
-    Node* last_left_step  = nullptr;
-    Node* last_right_step = nullptr;
-    
-    while (true) {
-      if (comp_(new_key, cur_node->data.first)) {
-        if (cur_node->left_th) {        
-          Node* new_node = new Node{new_key, new_value, last_right_step, cur_node, cur_node};
-          attach_left_child(cur_node, new_node);
-          fix_balance_up(new_node);
-          update_sentinel();
-          ++size_;
-          assert(validate(&std::cerr));
-          return {iterator(new_node), true};
-        }
-        last_left_step = cur_node;
-        cur_node = cur_node->left;
-      } else if (comp_(cur_node->data.first, new_key)) {
-        if (cur_node->right_th) {
-          Node* new_node = new Node{new_key, new_value, cur_node, last_left_step, cur_node};
-          attach_right_child(cur_node, new_node);
-          fix_balance_up(new_node);
-          update_sentinel();
-          ++size_;
-          assert(validate(&std::cerr));
-          return {iterator(new_node), true};
-        }
-        last_right_step = cur_node;
-        cur_node = cur_node->right;
-      } else {
-        // assert(validate(&std::cerr));
-        return {iterator(cur_node), false};
+      Node* new_node = create_node(std::forward<Args>(args)...);
+      InsertPos pos = find_insert_pos(new_node->data.first);
+      if (pos.found || size_ == max_size()) {
+        destroy_node(new_node);
+        if (pos.found) { return {iterator(pos.node), false}; }
+        throw std::length_error("ThreadedBinaryTree size exceeds max_size()");
       }
+      return {iterator(attach_new_node(pos, new_node)), true};
     }
   }
 
-  bool remove(const KeyT& key) {
+  // Вставка, если ключа нет; иначе аргументы значения не трогаются
+  template<typename... Args>
+  std::pair<iterator, bool> try_emplace(const KeyT& key, Args&&... args) {
+    return emplace_with_key(key, std::piecewise_construct,
+                            std::forward_as_tuple(key),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template<typename... Args>
+  std::pair<iterator, bool> try_emplace(KeyT&& key, Args&&... args) {
+    return emplace_with_key(key, std::piecewise_construct,
+                            std::forward_as_tuple(std::move(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template<typename... Args>
+  iterator try_emplace(const_iterator hint, const KeyT& key, Args&&... args) {
     assert(validate(&std::cerr));
+    InsertPos pos = find_insert_pos(hint, key);
+    if (pos.found) { return iterator(pos.node); }
+
+    if (size_ == max_size()) {
+      throw std::length_error("ThreadedBinaryTree size exceeds max_size()");
+    }
+    Node* new_node = create_node(std::piecewise_construct,
+                                 std::forward_as_tuple(key),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+    return iterator(attach_new_node(pos, new_node));
+  }
+
+  bool remove(const KeyT& key) {
     Node* tnode = find_node(key); 
     if (tnode == sentinel_) { return false; }
 
-    Node* balance_start = nullptr;
-    if (right_is_thread(tnode)) {
-      if (left_is_thread(tnode)) {
-        if (is_root(tnode)) {
-          root_ = nullptr;
-        } else if (is_left_child(tnode)) {
-          attach_left_thread(tnode->parent, tnode->left);
-        } else if (is_right_child(tnode)) {
-          attach_right_thread(tnode->parent, tnode->right);
-        }
-      } else {
-        if (is_root(tnode)) {
-          tnode->left->right  = nullptr;
-          tnode->left->parent = nullptr;
-          root_ = tnode->left;
-        } else if (is_left_child(tnode)) {
-          attach_right_thread(tnode->left, tnode->right);
-          attach_left_child(tnode->parent, tnode->left);
-        } else if (is_right_child(tnode)) {
-          attach_right_thread(tnode->left, tnode->right);
-          attach_right_child(tnode->parent, tnode->left);
-        }
-      }
-      balance_start = tnode->parent;
-    } else {
-      Node* rmin_node = extract_min(tnode->right);
-
-      rmin_node->right    = tnode->right;
-      rmin_node->right_th = tnode->right_th;
+    erase_node(tnode);
+    return true;
+  }
 
-      rmin_node->left    = tnode->left;
-      rmin_node->left_th = tnode->left_th;
+  // Удаление элемента по итератору без повторного поиска; возвращает следующий элемент
+  iterator erase(const_iterator pos) {
+    assert(pos != end());
+    Node* tnode = const_cast<Node*>(pos.node_);
+    Node* next  = const_cast<Node*>(std::next(pos).node_);
+    erase_node(tnode);
+    return iterator(next);
+  }
 
-      if (!tnode->right_th) {
-        tnode->right->parent = rmin_node;
-        attach_left_thread(left_most(tnode->right), rmin_node);
-      }
-      if (!tnode->left_th) {
-        tnode->left->parent = rmin_node;
-        attach_right_thread(right_most(tnode->left), rmin_node);
+  // Удаление [first, last); возвращает last.
+  // Для AVL большой диапазон вырезается двумя split и одним join: O(log n + k) без
+  // балансировки на каждый удаленный узел. Короткие диапазоны и другие схемы
+  // балансировки удаляются поэлементно
+  iterator erase(const_iterator first, const_iterator last) {
+    if constexpr (is_avl) {
+      if (first != last && index_of(last) - index_of(first) >= ERASE_SPLIT_CUTOFF) {
+        return erase_by_split(first, last);
       }
+    }
 
-      Node* tparent = tnode->parent;
-      rmin_node->parent = tparent;
-      if (is_root(tnode)) {
-        root_ = rmin_node;
-      } else if (is_left_child(tnode)) {
-        attach_left_child(tparent, rmin_node);
-      } else if (is_right_child(tnode)) {
-        attach_right_child(tparent, rmin_node);
-      }
-      balance_start = rmin_node;
-    } 
-     
-    fix_balance_up(balance_start);
-    update_sentinel();
+    while (first != last) { first = erase(first); }
+    return iterator(const_cast<Node*>(last.node_));
+  }
 
-    delete tnode;
-    --size_;
-  
-    assert(validate(&std::cerr));
-    return true;
+  // Удаление всех ключей из [lo, hi]; возвращает число удаленных элементов
+  size_t erase_range(const KeyT& lo, const KeyT& hi) {
+    if (comp_(hi, lo)) { return 0; }
+
+    size_t old_size = size_;
+    erase(lower_bound(lo), upper_bound(hi));
+    return old_size - size_;
   }
 
   // first not less than key
@@ -388,7 +479,364 @@ public:
     return const_iterator(find_bound(key, /* upper = */ true));
   }
 
+  template<typename K> requires TransparentCompare<CompT>
+  iterator lower_bound(const K& key) {
+    return iterator(const_cast<Node*>(find_bound(key, /* upper = */ false)));
+  }
+
+  template<typename K> requires TransparentCompare<CompT>
+  const_iterator lower_bound(const K& key) const {
+    return const_iterator(find_bound(key, /* upper = */ false));
+  }
+
+  template<typename K> requires TransparentCompare<CompT>
+  iterator upper_bound(const K& key) {
+    return iterator(const_cast<Node*>(find_bound(key, /* upper = */ true)));
+  }
+
+  template<typename K> requires TransparentCompare<CompT>
+  const_iterator upper_bound(const K& key) const {
+    return const_iterator(find_bound(key, /* upper = */ true));
+  }
+
+  // Число элементов строго меньше key, O(log n)
+  size_t rank(const KeyT& key) const {
+    return count_before(key, /* upper = */ false);
+  }
+
+  template<typename K> requires TransparentCompare<CompT>
+  size_t rank(const K& key) const {
+    return count_before(key, /* upper = */ false);
+  }
+
+  // Число элементов в [lo, hi], O(log n)
+  size_t count_range(const KeyT& lo, const KeyT& hi) const {
+    return count_range_impl(lo, hi);
+  }
+
+  template<typename K> requires TransparentCompare<CompT>
+  size_t count_range(const K& lo, const K& hi) const {
+    return count_range_impl(lo, hi);
+  }
+
+  // fn(const value_type&) для элементов с ключами в [lo, hi] по возрастанию, O(log n + k).
+  // Цикл по итераторам на большом дереве стоит на каждой загрузке следующего узла.
+  // Здесь обход идет по стеку левой ветви: правый ребенок узла запрашивается
+  // (prefetch) при попадании узла в стек и загружается, пока обходится его левое поддерево
+  template<typename F>
+  void for_each_in_range(const KeyT& lo, const KeyT& hi, F fn) const {
+    if (root_ == nullptr || comp_(hi, lo)) { return; }
+
+    // Высота дерева меньше 2 * 64 + 2 при любой балансировке
+    std::array<const Node*, 2 * 64 + 2> stack;
+    size_t top = 0;
+    auto push_left_branch = [&](const Node* node) {
+      for (; node != nullptr; node = left_ptr(node)) {
+        prefetch(right_ptr(node));
+        stack[top++] = node;
+      }
+    };
+
+    // Спуск к lower_bound(lo): в стеке остаются узлы, где путь ушел налево
+    for (const Node* node = root_; node != nullptr; ) {
+      if (comp_(node->data.first, lo)) {
+        node = right_ptr(node);
+      } else {
+        prefetch(right_ptr(node));
+        stack[top++] = node;
+        node = left_ptr(node);
+      }
+    }
+
+    while (top > 0) {
+      const Node* node = stack[--top];
+      if (comp_(hi, node->data.first)) { return; }
+      fn(node->data);
+      push_left_branch(right_ptr(node));
+    }
+  }
+
+  // k-й по возрастанию элемент (нумерация с нуля), end() при k >= size(); O(log n)
+  iterator nth(size_t k) {
+    return iterator(const_cast<Node*>(find_nth(k)));
+  }
+
+  const_iterator nth(size_t k) const {
+    return const_iterator(find_nth(k));
+  }
+
+  // Номер элемента в порядке возрастания (size() для end()), O(log n): nth(index_of(it)) == it
+  size_t index_of(const_iterator it) const {
+    const Node* node = it.node_;
+    if (node == sentinel_) { return size_; }
+
+    size_t res = subtree_size(left_ptr(node));
+    for (; node->parent != nullptr; node = node->parent) {
+      if (is_right_child(node)) {
+        res += subtree_size(left_ptr(node->parent)) + 1;
+      }
+    }
+    return res;
+  }
+
+  // Свертка AggT по элементам с ключами в [lo, hi], O(log n)
+  AggValue aggregate(const KeyT& lo, const KeyT& hi) const {
+    if (comp_(hi, lo)) { return AggT::identity(); }
+
+    // Спуск до первого узла внутри [lo, hi]: дальше границы расходятся по разным поддеревьям
+    const Node* node = root_;
+    while (node != nullptr) {
+      if (comp_(node->data.first, lo)) {
+        node = right_ptr(node);
+      } else if (comp_(hi, node->data.first)) {
+        node = left_ptr(node);
+      } else {
+        break;
+      }
+    }
+    if (node == nullptr) { return AggT::identity(); }
+
+    AggValue res = AggT::combine(aggregate_from(left_ptr(node), lo), lift(node));
+    return AggT::combine(res, aggregate_to(right_ptr(node), hi));
+  }
+
+  // Неизменяемый снимок дерева для фаз только чтения: поиск по массиву в порядке Eytzinger, O(n)
+  EytzingerSnapshot<KeyT, ValueT, CompT> freeze() const {
+    std::vector<std::pair<KeyT, ValueT>> items;
+    items.reserve(size_);
+    inorder([&items](const Node* node) { items.emplace_back(node->data.first, node->data.second); });
+    return EytzingerSnapshot<KeyT, ValueT, CompT>(std::move(items), comp_);
+  }
+
+  // Замена значения по ключу с пересчетом агрегатов на пути к корню, O(log n).
+  // false, если ключа нет
+  bool update(const KeyT& key, ValueT value) {
+    Node* node = find_node(key);
+    if (node == sentinel_) { return false; }
+    update(const_iterator(node), std::move(value));
+    return true;
+  }
+
+  void update(const_iterator it, ValueT value) {
+    Node* node = const_cast<Node*>(it.node_);
+    assert(node != sentinel_);
+    node->data.second = std::move(value);
+    if constexpr (!mutable_values) {
+      for (; node != nullptr; node = node->parent) { fixagg(node); }
+    }
+    assert(validate(&std::cerr));
+  }
+
+  // Построение дерева по отсортированной по ключу последовательности пар за O(n).
+  // Из подряд идущих равных ключей берется первый
+  template<typename InputIt>
+  static ThreadedBinaryTree from_sorted(InputIt first, InputIt last) {
+    ThreadedBinaryTree tree;
+    tree.assign_sorted(first, last);
+    return tree;
+  }
+
+  // Замена содержимого дерева на отсортированную последовательность за O(n)
+  template<typename InputIt>
+  void assign_sorted(InputIt first, InputIt last) {
+    ThreadedBinaryTree tmp;
+    tmp.comp_ = comp_;
+    tmp.build_sorted(first, last);
+    swap_with(tmp);
+  }
+
+  // Построение дерева из неупорядоченной последовательности пар за O(n log n).
+  // Из равных ключей остается встретившийся первым, как при поочередном insert.
+  // Сортировка, удаление повторов, создание узлов и сборка поддеревьев идут в
+  // нескольких потоках; в памяти одновременно лежат копия входа и узлы
+  template<typename InputIt>
+  static ThreadedBinaryTree from_unsorted(InputIt first, InputIt last) {
+    return from_unsorted(std::vector<std::pair<KeyT, ValueT>>(first, last));
+  }
+
+  static ThreadedBinaryTree from_unsorted(std::vector<std::pair<KeyT, ValueT>> items) {
+    ThreadedBinaryTree tree;
+    tree.build_unsorted(std::move(items));
+    return tree;
+  }
+
+  // Слияние деревьев, где все ключи left меньше key, а все ключи right больше key, за O(log n)
+  static ThreadedBinaryTree join(ThreadedBinaryTree left, const KeyT& key, const ValueT& value,
+                                 ThreadedBinaryTree right) {
+    static_assert(is_avl, "join/split are implemented for AvlBalance only");
+    assert(left.empty()  || left.comp_(left.sentinel_->left->data.first, key));
+    assert(right.empty() || left.comp_(key, right.sentinel_->right->data.first));
+
+    left.share_allocator_with(right);
+    Node* knode = left.create_node(key, value);
+    Node* lroot = left.release_root();
+    left.reset_root(left.join_nodes(lroot, knode, right.release_root()));
+    return left;
+  }
+
+  // Оставляет в дереве ключи < key, а ключи >= key возвращает отдельным деревом, O(log n).
+  // Узлы остаются в памяти аллокатора исходного дерева, которым обе части теперь владеют совместно
+  ThreadedBinaryTree split(const KeyT& key) {
+    static_assert(is_avl, "join/split are implemented for AvlBalance only");
+    ThreadedBinaryTree rhs{get_allocator()};
+    rhs.comp_ = comp_;
+
+    SplitParts parts = split_nodes(release_root(), key);
+    if (parts.mid != nullptr) {
+      parts.right = join_nodes(nullptr, parts.mid, parts.right);
+    }
+
+    reset_root(parts.left);
+    rhs.reset_root(parts.right);
+    return rhs;
+  }
+
+  // Теоретико-множественные операции над деревьями на основе join/split (только AvlBalance).
+  // Независимые подзадачи крупнее PARALLEL_CUTOFF решаются в отдельных потоках.
+  // При совпадении ключей значение берется из lhs
+
+  static ThreadedBinaryTree set_union(ThreadedBinaryTree lhs, ThreadedBinaryTree rhs) {
+    return combine(std::move(lhs), std::move(rhs), &ThreadedBinaryTree::union_nodes);
+  }
+
+  static ThreadedBinaryTree set_intersection(ThreadedBinaryTree lhs, ThreadedBinaryTree rhs) {
+    return combine(std::move(lhs), std::move(rhs), &ThreadedBinaryTree::intersection_nodes);
+  }
+
+  // Ключи lhs, которых нет в rhs
+  static ThreadedBinaryTree set_difference(ThreadedBinaryTree lhs, ThreadedBinaryTree rhs) {
+    return combine(std::move(lhs), std::move(rhs), &ThreadedBinaryTree::difference_nodes);
+  }
+
 private:
+  using NodeAlloc  = typename std::allocator_traits<AllocT>::template rebind_alloc<Node>;
+  using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+  // Место для вставки ключа: found - узел с таким ключом уже есть (node),
+  // иначе новый узел станет левым (to_left) или правым ребенком node.
+  // node == nullptr - дерево пусто
+  struct InsertPos {
+    Node* node;
+    bool found;
+    bool to_left;
+  };
+
+  template<typename... Args>
+  static constexpr bool key_is_first_arg() {
+    if constexpr (sizeof...(Args) == 2) {
+      using First = std::tuple_element_t<0, std::tuple<Args...>>;
+      return std::is_same_v<std::remove_cvref_t<First>, KeyT>;
+    } else {
+      return false;
+    }
+  }
+
+  template<typename... Args>
+  static constexpr bool key_is_pair_arg() {
+    if constexpr (sizeof...(Args) == 1) {
+      using Arg = std::remove_cvref_t<std::tuple_element_t<0, std::tuple<Args...>>>;
+      if constexpr (requires { typename Arg::first_type; }) {
+        return std::is_same_v<std::remove_cv_t<typename Arg::first_type>, KeyT>;
+      }
+    }
+    return false;
+  }
+
+  InsertPos find_insert_pos(const KeyT& key) {
+    Node* cur_node = root_;
+    if (cur_node == nullptr) { return {nullptr, false, false}; }
+
+    while (true) {
+      if (comp_(key, cur_node->data.first)) {
+        if (left_is_thread(cur_node)) { return {cur_node, false, true}; }
+        cur_node = cur_node->left;
+      } else if (comp_(cur_node->data.first, key)) {
+        if (right_is_thread(cur_node)) { return {cur_node, false, false}; }
+        cur_node = cur_node->right;
+      } else {
+        return {cur_node, true, false};
+      }
+    }
+  }
+
+  // Место для вставки key рядом с hint. Проверяются только hint и его сосед по нити
+  InsertPos find_insert_pos(const_iterator hint, const KeyT& key) {
+    if (root_ == nullptr) { return {nullptr, false, false}; }
+
+    Node* node = const_cast<Node*>(hint.node_);
+    if (node == sentinel_) {
+      // Дописывание в конец: правее максимума
+      Node* last = sentinel_->left;
+      if (comp_(last->data.first, key)) { return {last, false, false}; }
+      return find_insert_pos(key);
+    }
+
+    if (comp_(key, node->data.first)) {
+      Node* prev = left_is_thread(node) ? node->left : right_most(node->left);
+      if (prev == sentinel_ || comp_(prev->data.first, key)) {
+        // Между prev и node свободна ровно одна из сторон: левая у node или правая у prev
+        if (left_is_thread(node)) { return {node, false, true}; }
+        return {prev, false, false};
+      }
+    } else if (comp_(node->data.first, key)) {
+      Node* next = right_is_thread(node) ? node->right : left_most(node->right);
+      if (next == sentinel_ || comp_(key, next->data.first)) {
+        if (right_is_thread(node)) { return {node, false, false}; }
+        return {next, false, true};
+      }
+    } else {
+      return {node, true, false};
+    }
+
+    return find_insert_pos(key);
+  }
+
+  // Подвешивает новый узел в найденное find_insert_pos место.
+  // Повороты не меняют порядок обхода, поэтому sentinel_ правится только для нового крайнего узла
+  Node* attach_new_node(const InsertPos& pos, Node* new_node) {
+    assert(!pos.found);
+    Node* parent = pos.node;
+    if (parent == nullptr) {
+      root_ = new_node;
+      update_sentinel();
+    } else if (pos.to_left) {
+      attach_left_thread(new_node, parent->left);
+      attach_right_thread(new_node, parent);
+      new_node->parent = parent;
+      attach_left_child(parent, new_node);
+      if (new_node->left == sentinel_) { sentinel_->right = new_node; }
+      fix_balance_up(new_node);
+    } else {
+      attach_left_thread(new_node, parent);
+      attach_right_thread(new_node, parent->right);
+      new_node->parent = parent;
+      attach_right_child(parent, new_node);
+      if (new_node->right == sentinel_) { sentinel_->left = new_node; }
+      fix_balance_up(new_node);
+    }
+    ++size_;
+    assert(validate(&std::cerr));
+    return new_node;
+  }
+
+  template<typename... Args>
+  std::pair<iterator, bool> emplace_with_key(const KeyT& key, Args&&... args) {
+    assert(validate(&std::cerr));
+    InsertPos pos = find_insert_pos(key);
+    if (pos.found) { return {iterator(pos.node), false}; }
+
+    if (size_ == max_size()) {
+      throw std::length_error("ThreadedBinaryTree size exceeds max_size()");
+    }
+    Node* new_node = create_node(std::forward<Args>(args)...);
+    return {iterator(attach_new_node(pos, new_node)), true};
+  }
+
+  static constexpr bool is_avl  = std::is_same_v<BalanceT, AvlBalance>;
+  static constexpr bool is_wavl = std::is_same_v<BalanceT, WavlBalance>;
+  static constexpr bool is_rb   = std::is_same_v<BalanceT, RedBlackBalance>;
+  static_assert(is_avl || is_wavl || is_rb, "BalanceT must be AvlBalance, WavlBalance or RedBlackBalance");
+
   // Константы для балансировки AVL-дерева
   static constexpr int BALANCE_THRESHOLD_RIGHT =  2;   // Правое поддерево слишком высокое
   static constexpr int BALANCE_THRESHOLD_LEFT  = -2;   // Левое поддерево слишком высокое
@@ -449,7 +897,8 @@ private:
   // Обобщенный поиск границы (lower_bound или upper_bound)
   // upper = false: lower_bound (первый >= key)
   // upper = true:  upper_bound (первый > key)
-  const Node* find_bound(const KeyT& key, bool upper) const {
+  template<typename K>
+  const Node* find_bound(const K& key, bool upper) const {
     if (root_ == nullptr) { return sentinel_; }
 
     const Node* cur_node = root_;
@@ -473,8 +922,56 @@ private:
     return res;
   }
 
+  template<typename K>
+  size_t count_range_impl(const K& lo, const K& hi) const {
+    if (comp_(hi, lo)) { return 0; }
+    return count_before(hi, /* upper = */ true) - count_before(lo, /* upper = */ false);
+  }
+
+  const Node* find_nth(size_t k) const {
+    if (k >= size_) { return sentinel_; }
+
+    const Node* node = root_;
+    while (true) {
+      size_t left_size = subtree_size(left_ptr(node));
+      if (k < left_size) {
+        node = left_ptr(node);
+      } else if (k == left_size) {
+        return node;
+      } else {
+        k -= left_size + 1;
+        node = right_ptr(node);
+      }
+    }
+  }
+
+  // Число элементов левее границы из find_bound:
+  // upper = false: сколько элементов < key
+  // upper = true:  сколько элементов <= key
+  template<typename K>
+  size_t count_before(const K& key, bool upper) const {
+    size_t res = 0;
+    const Node* cur_node = root_;
+
+    while (cur_node != nullptr) {
+      bool go_left = upper 
+        ? comp_(key, cur_node->data.first)
+        : !comp_(cur_node->data.first, key);
+
+      if (go_left) {
+        cur_node = left_ptr(cur_node);
+      } else {
+        res += subtree_size(left_ptr(cur_node)) + 1;
+        cur_node = right_ptr(cur_node);
+      }
+    }
+
+    return res;
+  }
+
   // Поиск элемента по ключу (const версия)
-  const Node* find_node(const KeyT& key) const {
+  template<typename K>
+  const Node* find_node(const K& key) const {
     const Node* cur_node = root_;
     if (cur_node == nullptr) { return sentinel_; }
     while (cur_node != sentinel_) {
@@ -492,7 +989,8 @@ private:
   }
 
   // Поиск элемента по ключу (non-const версия через const)
-  Node* find_node(const KeyT& key) {
+  template<typename K>
+  Node* find_node(const K& key) {
     return const_cast<Node*>(std::as_const(*this).find_node(key));
   }
 
@@ -525,7 +1023,107 @@ private:
         node = left_most(node->right);
       }
     }
-    // assert(validate(&std::cerr));
+    // assert(validate(&std::cerr));
+  }
+
+  // Диапазон такой длины дешевле вырезать через split/join, чем удалять поэлементно
+  static constexpr size_t ERASE_SPLIT_CUTOFF = 32;
+
+  void erase_node(Node* tnode) {
+    assert(validate(&std::cerr));
+
+    Node* balance_start = nullptr;
+    if (right_is_thread(tnode)) {
+      if (left_is_thread(tnode)) {
+        if (is_root(tnode)) {
+          root_ = nullptr;
+        } else if (is_left_child(tnode)) {
+          attach_left_thread(tnode->parent, tnode->left);
+        } else if (is_right_child(tnode)) {
+          attach_right_thread(tnode->parent, tnode->right);
+        }
+      } else {
+        if (is_root(tnode)) {
+          tnode->left->right  = nullptr;
+          tnode->left->parent = nullptr;
+          root_ = tnode->left;
+        } else if (is_left_child(tnode)) {
+          attach_right_thread(tnode->left, tnode->right);
+          attach_left_child(tnode->parent, tnode->left);
+          tnode->left->parent = tnode->parent;
+        } else if (is_right_child(tnode)) {
+          attach_right_thread(tnode->left, tnode->right);
+          attach_right_child(tnode->parent, tnode->left);
+          tnode->left->parent = tnode->parent;
+        }
+      }
+      balance_start = tnode->parent;
+    } else {
+      Node* rmin_node = extract_min(tnode->right);
+      rmin_node->height = tnode->height;
+
+      rmin_node->right    = tnode->right;
+      rmin_node->right_th = tnode->right_th;
+
+      rmin_node->left    = tnode->left;
+      rmin_node->left_th = tnode->left_th;
+
+      if (!tnode->right_th) {
+        tnode->right->parent = rmin_node;
+        attach_left_thread(left_most(tnode->right), rmin_node);
+      }
+      if (!tnode->left_th) {
+        tnode->left->parent = rmin_node;
+        attach_right_thread(right_most(tnode->left), rmin_node);
+      }
+
+      Node* tparent = tnode->parent;
+      rmin_node->parent = tparent;
+      if (is_root(tnode)) {
+        root_ = rmin_node;
+      } else if (is_left_child(tnode)) {
+        attach_left_child(tparent, rmin_node);
+      } else if (is_right_child(tnode)) {
+        attach_right_child(tparent, rmin_node);
+      }
+      balance_start = rmin_node;
+    } 
+     
+    fix_balance_up(balance_start);
+    update_sentinel();
+
+    destroy_node(tnode);
+    --size_;
+  
+    assert(validate(&std::cerr));
+  }
+
+  iterator erase_by_split(const_iterator first, const_iterator last) {
+    // Узлы first и last живут до конца разрезания, ссылки на ключи остаются верными
+    const KeyT& first_key = first.node_->data.first;
+    Node* last_node = const_cast<Node*>(last.node_);
+
+    SplitParts head = split_nodes(release_root(), first_key);
+    Node* rest = join_nodes(nullptr, head.mid, head.right);
+
+    Node* middle = rest;
+    Node* tail   = nullptr;
+    if (last_node != sentinel_) {
+      SplitParts parts = split_nodes(rest, last_node->data.first);
+      middle = parts.left;
+      tail   = join_nodes(nullptr, parts.mid, parts.right);
+    }
+
+    destroy_subtree(middle);
+    reset_root(join2_nodes(head.left, tail));
+    return iterator(last_node);
+  }
+
+  void destroy_subtree(Node* node) {
+    if (node == nullptr) { return; }
+    destroy_subtree(left_ptr(node));
+    destroy_subtree(right_ptr(node));
+    destroy_node(node);
   }
 
   Node* extract_min(Node* node) {
@@ -569,10 +1167,16 @@ private:
   }
 
   void fix_balance_up(Node* node) {
+    if (node != nullptr) { root_ = rebalance_to_top(node); }
+  }
+
+  // Балансировка от node до вершины его дерева (узла без родителя); возвращает новую вершину
+  Node* rebalance_to_top(Node* node) {
+    Node* top = nullptr;
     while(node != nullptr) {
       Node* parent = node->parent;
       if (parent == nullptr) {
-        root_ = balance(node);
+        top = balance(node);
       } else if (is_left_child(node)) {
         parent->left = balance(node);
       } else if (is_right_child(node)) {
@@ -580,6 +1184,7 @@ private:
       }
       node = parent;
     }
+    return top;
   }
 
   int height(const Node* node) const {
@@ -593,7 +1198,69 @@ private:
   void fixheight(Node* node) {
     int hl = height(left_ptr(node));
     int hr = height(right_ptr(node));
-    node->height = std::max(hl, hr) + 1;
+    node->height = static_cast<uint8_t>(std::max(hl, hr) + 1);
+  }
+
+  size_t subtree_size(const Node* node) const {
+    return (node == nullptr) ? 0 : node->size;
+  }
+
+  void fixsize(Node* node) {
+    node->size = subtree_size(left_ptr(node)) + subtree_size(right_ptr(node)) + 1;
+  }
+
+  AggValue subtree_agg(const Node* node) const {
+    return (node == nullptr) ? AggT::identity() : node->agg;
+  }
+
+  static AggValue lift(const Node* node) {
+    return AggT::lift(node->data.first, node->data.second);
+  }
+
+  void fixagg(Node* node) {
+    if constexpr (!std::is_same_v<AggT, NoAggregate>) {
+      AggValue res = AggT::combine(subtree_agg(left_ptr(node)), lift(node));
+      node->agg = AggT::combine(res, subtree_agg(right_ptr(node)));
+    }
+  }
+
+  // Свертка по ключам >= lo в поддереве node
+  AggValue aggregate_from(const Node* node, const KeyT& lo) const {
+    AggValue res = AggT::identity();
+    while (node != nullptr) {
+      if (comp_(node->data.first, lo)) {
+        node = right_ptr(node);
+      } else {
+        // node и его правое поддерево целиком в диапазоне и левее накопленного
+        AggValue part = AggT::combine(lift(node), subtree_agg(right_ptr(node)));
+        res = AggT::combine(part, res);
+        node = left_ptr(node);
+      }
+    }
+    return res;
+  }
+
+  // Свертка по ключам <= hi в поддереве node
+  AggValue aggregate_to(const Node* node, const KeyT& hi) const {
+    AggValue res = AggT::identity();
+    while (node != nullptr) {
+      if (comp_(hi, node->data.first)) {
+        node = left_ptr(node);
+      } else {
+        AggValue part = AggT::combine(subtree_agg(left_ptr(node)), lift(node));
+        res = AggT::combine(res, part);
+        node = right_ptr(node);
+      }
+    }
+    return res;
+  }
+
+  // Пересчет всех вычисляемых полей узла по его детям.
+  // Ранг WAVL и красно-черного дерева меняется только явно при балансировке
+  void update_node(Node* node) {
+    if constexpr (is_avl) { fixheight(node); }
+    fixsize(node);
+    fixagg(node);
   }
 
   const Node* left_ptr(const Node* node) const {
@@ -606,13 +1273,29 @@ private:
     return right_is_thread(node) ? nullptr : node->right;
   }
 
+  static void prefetch([[maybe_unused]] const Node* node) {
+#if defined(__GNUC__)
+    if (node != nullptr) { __builtin_prefetch(node); }
+#endif
+  }
+
+  Node* left_ptr(Node* node) const {
+    assert(node != nullptr);
+    return left_is_thread(node) ? nullptr : node->left;
+  }
+
+  Node* right_ptr(Node* node) const {
+    assert(node != nullptr);
+    return right_is_thread(node) ? nullptr : node->right;
+  }
+
   Node* rotate_right(Node* node) {
     if (node == nullptr) { return nullptr; }
 
     assert(!left_is_thread(node));
     Node* lnode = node->left;
 
-    if (!left_is_thread(lnode)) {
+    if (!right_is_thread(lnode)) {
       lnode->right->parent = node;
       node->left = lnode->right;
     } else {
@@ -624,8 +1307,8 @@ private:
 
     attach_right_child(lnode, node);
 
-    fixheight(node);
-    fixheight(lnode);
+    update_node(node);
+    update_node(lnode);
     return lnode; 
   }
 
@@ -649,13 +1332,27 @@ private:
     rnode->left = node;
     rnode->left_th = false;
 
-    fixheight(node);
-    fixheight(rnode);
+    update_node(node);
+    update_node(rnode);
     return rnode;
   }
 
+  // Восстанавливает баланс в узле p, если поддеревья его детей уже сбалансированы;
+  // возвращает новую вершину поддерева. Вызывается для каждого узла на пути к корню
   Node* balance(Node* p) {
-    fixheight(p);
+    if constexpr (is_avl) {
+      return balance_avl(p);
+    } else if constexpr (is_wavl) {
+      update_node(p);
+      return balance_wavl(p);
+    } else {
+      update_node(p);
+      return balance_rb(p);
+    }
+  }
+
+  Node* balance_avl(Node* p) {
+    update_node(p);
     if (bfactor(p) == BALANCE_THRESHOLD_RIGHT) {
       if (bfactor(p->right) < 0) {
         p->right = rotate_right(p->right);
@@ -672,6 +1369,177 @@ private:
     return p;
   }
 
+  // ---- ранговая балансировка (WAVL и красно-черное дерево) ----
+  //
+  // Нарушения ищутся по разностям рангов у p и его детей, поэтому после вставки и после
+  // удаления достаточно пройти от места изменения к корню, вызывая balance для каждого узла.
+  // Ранги повернутых узлов правятся явно; size и agg пересчитывают повороты
+
+  int rank_diff(const Node* parent, const Node* child) const {
+    return parent->height - height(child);
+  }
+
+  static void promote(Node* node, int by = 1) { node->height = static_cast<uint8_t>(node->height + by); }
+  static void demote(Node* node, int by = 1)  { node->height = static_cast<uint8_t>(node->height - by); }
+
+  bool is_leaf(const Node* node) const {
+    return left_is_thread(node) && right_is_thread(node);
+  }
+
+  // Внешний (дальний от брата) и внутренний ребенок узла y, который сам - ребенок родителя
+  // со стороны y_left
+  Node* outer_child(Node* y, bool y_left) { return y_left ? left_ptr(y) : right_ptr(y); }
+  Node* inner_child(Node* y, bool y_left) { return y_left ? right_ptr(y) : left_ptr(y); }
+
+  // Поворот, поднимающий ребенка p со стороны child_left
+  Node* rotate_up(Node* p, bool child_left) {
+    return child_left ? rotate_right(p) : rotate_left(p);
+  }
+
+  // Двойной поворот, поднимающий внутреннего внука p со стороны child_left
+  Node* rotate_up_twice(Node* p, bool child_left) {
+    if (child_left) {
+      p->left = rotate_left(p->left);
+      return rotate_right(p);
+    }
+    p->right = rotate_right(p->right);
+    return rotate_left(p);
+  }
+
+  Node* balance_wavl(Node* p) {
+    Node* l = left_ptr(p);
+    Node* r = right_ptr(p);
+
+    // После удаления: лист с рангом 2
+    if (l == nullptr && r == nullptr) {
+      if (p->height == 2) { demote(p); }
+      return p;
+    }
+
+    // После вставки: ребенок с разностью 0
+    for (bool x_left : {true, false}) {
+      Node* x = x_left ? l : r;
+      if (x == nullptr || rank_diff(p, x) != 0) { continue; }
+
+      Node* y = x_left ? r : l;
+      if (rank_diff(p, y) == 1) {
+        promote(p);
+        return p;
+      }
+
+      // Брат - 2-ребенок: x имеет детей с разностями 1 и 2
+      Node* z = inner_child(x, x_left);
+      if (rank_diff(x, z) == 2) {
+        demote(p);
+        return rotate_up(p, x_left);
+      }
+      promote(z);
+      demote(x);
+      demote(p);
+      return rotate_up_twice(p, x_left);
+    }
+
+    // После удаления: ребенок (возможно, отсутствующий) с разностью 3
+    for (bool x_left : {true, false}) {
+      Node* x = x_left ? l : r;
+      if (rank_diff(p, x) != 3) { continue; }
+
+      Node* y = x_left ? r : l;
+      if (rank_diff(p, y) == 2) {
+        demote(p);
+        return p;
+      }
+
+      Node* v = outer_child(y, !x_left);
+      Node* w = inner_child(y, !x_left);
+      if (rank_diff(y, v) == 2 && rank_diff(y, w) == 2) {
+        demote(p);
+        demote(y);
+        return p;
+      }
+
+      if (rank_diff(y, v) == 1) {
+        promote(y);
+        demote(p);
+        if (inner_child(y, !x_left) == nullptr && x == nullptr) { demote(p); }
+        return rotate_up(p, !x_left);
+      }
+      promote(w, 2);
+      demote(y);
+      demote(p, 2);
+      return rotate_up_twice(p, !x_left);
+    }
+
+    return p;
+  }
+
+  Node* balance_rb(Node* p) {
+    Node* l = left_ptr(p);
+    Node* r = right_ptr(p);
+
+    // После вставки: 0-ребенок x с 0-ребенком (два красных подряд)
+    for (bool x_left : {true, false}) {
+      Node* x = x_left ? l : r;
+      if (x == nullptr || rank_diff(p, x) != 0) { continue; }
+
+      Node* outer = outer_child(x, x_left);
+      Node* inner = inner_child(x, x_left);
+      bool outer_red = outer != nullptr && rank_diff(x, outer) == 0;
+      bool inner_red = inner != nullptr && rank_diff(x, inner) == 0;
+      if (!outer_red && !inner_red) { continue; }
+
+      Node* y = x_left ? r : l;
+      if (rank_diff(p, y) == 0) {
+        promote(p);
+        return p;
+      }
+      // Ранги при поворотах не меняются: новая вершина черная, p становится красным
+      return outer_red ? rotate_up(p, x_left) : rotate_up_twice(p, x_left);
+    }
+
+    // После удаления: ребенок (возможно, отсутствующий) с разностью 2
+    for (bool x_left : {true, false}) {
+      Node* x = x_left ? l : r;
+      if (rank_diff(p, x) != 2) { continue; }
+
+      Node* y = x_left ? r : l;
+      if (rank_diff(p, y) == 0) {
+        // Красный брат: поворотом он становится вершиной, а p - его красным ребенком
+        // с черным братом
+        Node* top = rotate_up(p, !x_left);
+        if (x_left) {
+          top->left = balance_rb(p);
+          top->left->parent = top;
+        } else {
+          top->right = balance_rb(p);
+          top->right->parent = top;
+        }
+        update_node(top);
+        return top;
+      }
+
+      Node* v = outer_child(y, !x_left);
+      Node* w = inner_child(y, !x_left);
+      bool outer_red = v != nullptr && rank_diff(y, v) == 0;
+      bool inner_red = w != nullptr && rank_diff(y, w) == 0;
+
+      if (!outer_red && !inner_red) {
+        demote(p);
+        return p;
+      }
+      if (outer_red) {
+        promote(y);
+        demote(p);
+        return rotate_up(p, !x_left);
+      }
+      promote(w);
+      demote(p);
+      return rotate_up_twice(p, !x_left);
+    }
+
+    return p;
+  }
+
   // Поиск самого левого узла относительно заданного
   static Node* left_most(Node* root) {
     if (root == nullptr) { return nullptr; }
@@ -710,9 +1578,515 @@ private:
     return res;
   }
 
+  template<typename... Args>
+  Node* create_node(Args&&... args) {
+    Node* node = NodeTraits::allocate(alloc_, 1);
+    try {
+      NodeTraits::construct(alloc_, node, std::forward<Args>(args)...);
+    } catch (...) {
+      NodeTraits::deallocate(alloc_, node, 1);
+      throw;
+    }
+    return node;
+  }
+
+  void destroy_node(Node* node) noexcept {
+    NodeTraits::destroy(alloc_, node);
+    NodeTraits::deallocate(alloc_, node, 1);
+  }
+
+  template<typename InputIt>
+  void build_sorted(InputIt first, InputIt last) {
+    assert(root_ == nullptr);
+
+    std::vector<Node*> nodes;
+    if constexpr (std::forward_iterator<InputIt>) {
+      nodes.reserve(static_cast<size_t>(std::distance(first, last)));
+    }
+
+    try {
+      for (; first != last; ++first) {
+        const auto& item = *first;
+        if (!nodes.empty()) {
+          const KeyT& prev_key = nodes.back()->data.first;
+          assert(!comp_(item.first, prev_key) && "from_sorted: input is not sorted");
+          if (!comp_(prev_key, item.first)) { continue; }
+        }
+        if (nodes.size() == max_size()) {
+          throw std::length_error("ThreadedBinaryTree size exceeds max_size()");
+        }
+        nodes.push_back(create_node(item.first, item.second));
+      }
+    } catch (...) {
+      for (Node* node : nodes) { destroy_node(node); }
+      throw;
+    }
+
+    link_all(nodes, parallel_depth());
+  }
+
+  // Собирает дерево из созданных узлов, упорядоченных по ключу без повторов
+  void link_all(const std::vector<Node*>& nodes, int depth) {
+    root_ = link_sorted(nodes, 0, nodes.size(), nullptr, depth);
+    size_ = nodes.size();
+
+    // Дерево с высотами детей, отличающимися не больше чем на 1, - корректное WAVL-дерево,
+    // а ранги ceil(h / 2) делают его красно-черным
+    if constexpr (is_rb) {
+      for (Node* node : nodes) { node->height = static_cast<uint8_t>((node->height + 1) / 2); }
+    }
+    update_sentinel();
+    assert(validate(&std::cerr));
+  }
+
+  // Делает nodes[mid] корнем поддерева из nodes[lo, hi): половины расходятся в
+  // детей, а пустая сторона становится нитью на соседа в массиве.
+  // Поддеревья пишут только в свои узлы, поэтому крупные собираются в разных потоках
+  Node* link_sorted(const std::vector<Node*>& nodes, size_t lo, size_t hi, Node* parent, int depth) {
+    if (lo == hi) { return nullptr; }
+
+    size_t mid = lo + (hi - lo) / 2;
+    Node* node = nodes[mid];
+    node->parent = parent;
+
+    Node* lnode = nullptr;
+    Node* rnode = nullptr;
+    if (depth > 0 && hi - lo >= PARALLEL_CUTOFF) {
+      run_parallel([&] { lnode = link_sorted(nodes, lo, mid, node, depth - 1); },
+                   [&] { rnode = link_sorted(nodes, mid + 1, hi, node, depth - 1); });
+    } else {
+      lnode = link_sorted(nodes, lo, mid, node, 0);
+      rnode = link_sorted(nodes, mid + 1, hi, node, 0);
+    }
+
+    if (lnode != nullptr) {
+      attach_left_child(node, lnode);
+    } else {
+      attach_left_thread(node, mid > 0 ? nodes[mid - 1] : sentinel_);
+    }
+
+    if (rnode != nullptr) {
+      attach_right_child(node, rnode);
+    } else {
+      attach_right_thread(node, mid + 1 < nodes.size() ? nodes[mid + 1] : sentinel_);
+    }
+
+    // Высоты нужны при любой балансировке: по ним build_sorted расставляет ранги
+    fixheight(node);
+    update_node(node);
+    return node;
+  }
+
+  // ---- параллельное построение из неупорядоченных данных ----
+
+  void build_unsorted(std::vector<std::pair<KeyT, ValueT>> items) {
+    assert(root_ == nullptr);
+
+    int depth = parallel_depth();
+    auto by_key = [this](const auto& a, const auto& b) { return comp_(a.first, b.first); };
+    parallel_sort(items.begin(), items.end(), by_key, depth);
+
+    // Сортировка устойчивая: из равных ключей первым стоит встретившийся раньше.
+    // Куски размечаются независимо, затем по префиксным суммам каждый кусок
+    // создает свои узлы на своем месте в nodes
+    size_t n = items.size();
+    size_t chunks = std::clamp<size_t>(n / PARALLEL_CUTOFF, 1, size_t{1} << depth);
+    std::vector<size_t> offset(chunks + 1, 0);
+    std::vector<uint8_t> keep(n);
+    auto chunk_begin = [&](size_t c) { return n * c / chunks; };
+
+    for_each_chunk(0, chunks, [&](size_t c) {
+      size_t kept = 0;
+      for (size_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+        keep[i] = (i == 0 || comp_(items[i - 1].first, items[i].first));
+        kept += keep[i];
+      }
+      offset[c + 1] = kept;
+    });
+    for (size_t c = 0; c < chunks; ++c) { offset[c + 1] += offset[c]; }
+
+    if (offset[chunks] > max_size()) {
+      throw std::length_error("ThreadedBinaryTree size exceeds max_size()");
+    }
+
+    // Память под узлы выделяется заранее одним потоком: аллокатор не потокобезопасен
+    std::vector<Node*> nodes;
+    nodes.reserve(offset[chunks]);
+    try {
+      while (nodes.size() < offset[chunks]) { nodes.push_back(NodeTraits::allocate(alloc_, 1)); }
+    } catch (...) {
+      for (Node* node : nodes) { NodeTraits::deallocate(alloc_, node, 1); }
+      throw;
+    }
+
+    std::vector<size_t> built(chunks, 0);
+    std::vector<std::exception_ptr> errors(chunks);
+    for_each_chunk(0, chunks, [&](size_t c) {
+      try {
+        Node** out = nodes.data() + offset[c];
+        for (size_t i = chunk_begin(c); i < chunk_begin(c + 1); ++i) {
+          if (!keep[i]) { continue; }
+          NodeTraits::construct(alloc_, out[built[c]], std::move(items[i].first), std::move(items[i].second));
+          ++built[c];
+        }
+      } catch (...) {
+        errors[c] = std::current_exception();
+      }
+    });
+
+    for (size_t c = 0; c < chunks; ++c) {
+      if (errors[c] == nullptr) { continue; }
+      for (size_t j = 0; j < chunks; ++j) {
+        for (size_t k = 0; k < built[j]; ++k) { NodeTraits::destroy(alloc_, nodes[offset[j] + k]); }
+      }
+      for (Node* node : nodes) { NodeTraits::deallocate(alloc_, node, 1); }
+      std::rethrow_exception(errors[c]);
+    }
+
+    link_all(nodes, depth);
+  }
+
+  // Устойчивая сортировка слиянием: половины сортируются в разных потоках
+  template<typename RandomIt, typename Comp>
+  static void parallel_sort(RandomIt first, RandomIt last, Comp comp, int depth) {
+    size_t n = static_cast<size_t>(last - first);
+    if (depth == 0 || n < PARALLEL_CUTOFF) {
+      std::stable_sort(first, last, comp);
+      return;
+    }
+
+    RandomIt mid = first + n / 2;
+    run_parallel([&] { parallel_sort(first, mid, comp, depth - 1); },
+                 [&] { parallel_sort(mid, last, comp, depth - 1); });
+    std::inplace_merge(first, mid, last, comp);
+  }
+
+  // body(c) для всех кусков c из [lo, hi), каждый кусок в своем потоке
+  template<typename F>
+  static void for_each_chunk(size_t lo, size_t hi, const F& body) {
+    if (hi - lo == 1) {
+      body(lo);
+      return;
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    run_parallel([&] { for_each_chunk(lo, mid, body); },
+                 [&] { for_each_chunk(mid, hi, body); });
+  }
+
+  // Выполняет left в отдельном потоке, а right в текущем; если поток не
+  // запустился - обе задачи последовательно
+  template<typename LeftF, typename RightF>
+  static void run_parallel(LeftF left, RightF right) {
+    std::future<void> left_future;
+    try {
+      left_future = std::async(std::launch::async, left);
+    } catch (const std::system_error&) {
+      left();
+      right();
+      return;
+    }
+    right();
+    left_future.get();
+  }
+
+  // Глубина, до которой задачи раздаются потокам: 2^depth потоков на вершине
+  static int parallel_depth() {
+    return std::bit_width(std::thread::hardware_concurrency());
+  }
+
+  // ---- join / split ----
+  //
+  // Работают с поддеревьями без родителя (node->parent == nullptr) и не трогают root_,
+  // поэтому независимые поддеревья можно обрабатывать параллельно.
+  // Нити внутри частей остаются верными, пока соседи в порядке обхода не меняются;
+  // join_nodes перенаправляет нити на стыке, а нити крайних узлов итогового дерева
+  // исправляет update_sentinel()
+
+  struct SplitParts {
+    Node* left;
+    Node* mid;    // узел с ключом, равным ключу разбиения, или nullptr
+    Node* right;
+  };
+
+  static Node* detach(Node* node) {
+    if (node != nullptr) { node->parent = nullptr; }
+    return node;
+  }
+
+  // Делает l и r детьми knode; пустая сторона становится нитью на pred/succ
+  void link_node(Node* knode, Node* l, Node* r, Node* pred, Node* succ) {
+    if (l != nullptr) {
+      attach_left_child(knode, l);
+      l->parent = knode;
+    } else {
+      attach_left_thread(knode, pred != nullptr ? pred : sentinel_);
+    }
+
+    if (r != nullptr) {
+      attach_right_child(knode, r);
+      r->parent = knode;
+    } else {
+      attach_right_thread(knode, succ != nullptr ? succ : sentinel_);
+    }
+
+    update_node(knode);
+  }
+
+  // Дерево из узлов l, knode, r (все ключи l < knode < все ключи r), O(|h(l) - h(r)| + 1)
+  Node* join_nodes(Node* l, Node* knode, Node* r) {
+    Node* pred = right_most(l);
+    Node* succ = left_most(r);
+    if (pred != nullptr) { attach_right_thread(pred, knode); }
+    if (succ != nullptr) { attach_left_thread(succ, knode); }
+    knode->parent = nullptr;
+
+    int hl = height(l);
+    int hr = height(r);
+
+    if (hl > hr + 1) {
+      // Спуск по правому краю l до поддерева высоты не больше h(r) + 1
+      Node* parent = l;
+      Node* cur = right_ptr(l);
+      while (height(cur) > hr + 1) {
+        parent = cur;
+        cur = right_ptr(cur);
+      }
+      link_node(knode, cur, r, pred, succ);
+      attach_right_child(parent, knode);
+      knode->parent = parent;
+      return rebalance_to_top(parent);
+    }
+
+    if (hr > hl + 1) {
+      Node* parent = r;
+      Node* cur = left_ptr(r);
+      while (height(cur) > hl + 1) {
+        parent = cur;
+        cur = left_ptr(cur);
+      }
+      link_node(knode, l, cur, pred, succ);
+      attach_left_child(parent, knode);
+      knode->parent = parent;
+      return rebalance_to_top(parent);
+    }
+
+    link_node(knode, l, r, pred, succ);
+    return knode;
+  }
+
+  // Слияние без разделяющего ключа: им становится максимум l
+  Node* join2_nodes(Node* l, Node* r) {
+    if (l == nullptr) { return r; }
+    auto [rest, last] = split_last(l);
+    return join_nodes(rest, last, r);
+  }
+
+  // Отделяет максимальный узел дерева
+  std::pair<Node*, Node*> split_last(Node* node) {
+    Node* l = detach(left_ptr(node));
+    Node* r = detach(right_ptr(node));
+    if (r == nullptr) { return {l, node}; }
+
+    auto [rest, last] = split_last(r);
+    return {join_nodes(l, node, rest), last};
+  }
+
+  SplitParts split_nodes(Node* node, const KeyT& key) {
+    if (node == nullptr) { return {nullptr, nullptr, nullptr}; }
+
+    Node* l = detach(left_ptr(node));
+    Node* r = detach(right_ptr(node));
+
+    if (comp_(key, node->data.first)) {
+      SplitParts parts = split_nodes(l, key);
+      return {parts.left, parts.mid, join_nodes(parts.right, node, r)};
+    }
+    if (comp_(node->data.first, key)) {
+      SplitParts parts = split_nodes(r, key);
+      return {join_nodes(l, node, parts.left), parts.mid, parts.right};
+    }
+    return {l, node, r};
+  }
+
+  // Забирает узлы у дерева, оставляя его пустым
+  Node* release_root() {
+    Node* root = root_;
+    root_ = nullptr;
+    size_ = 0;
+    update_sentinel();
+    return detach(root);
+  }
+
+  void reset_root(Node* root) {
+    assert(root_ == nullptr);
+    root_ = root;
+    size_ = subtree_size(root);
+    update_sentinel();
+    assert(validate(&std::cerr));
+  }
+
+  // Перед переносом узлов other в это дерево: их память должна освобождаться через alloc_.
+  // Пул просто берет чужие куски под свое владение, иначе узлы other копируются
+  void share_allocator_with(ThreadedBinaryTree& other) {
+    if (alloc_ == other.alloc_) { return; }
+
+    if constexpr (requires(NodeAlloc& alloc) { alloc.adopt(alloc); }) {
+      alloc_.adopt(other.alloc_);
+    } else {
+      ThreadedBinaryTree tmp{get_allocator()};
+      tmp.comp_ = other.comp_;
+      tmp.size_ = other.size_;
+      tmp.root_ = other.copy(tmp);
+      tmp.update_sentinel();
+      other.swap_with(tmp);
+    }
+  }
+
+  // ---- параллельные операции над множествами ----
+
+  // Подзадачи меньше этого числа узлов решаются последовательно
+  static constexpr size_t PARALLEL_CUTOFF = size_t{1} << 14;
+
+  // Узлы, выброшенные из результата. Связаны через parent и освобождаются после
+  // завершения всех потоков: аллокатор не потокобезопасен
+  struct DropList {
+    Node* head = nullptr;
+    Node* tail = nullptr;
+
+    void push(Node* node) {
+      node->parent = head;
+      head = node;
+      if (tail == nullptr) { tail = node; }
+    }
+
+    void append(DropList& other) {
+      if (other.head == nullptr) { return; }
+      other.tail->parent = head;
+      head = other.head;
+      if (tail == nullptr) { tail = other.tail; }
+    }
+  };
+
+  using SetOp = Node* (ThreadedBinaryTree::*)(Node*, Node*, DropList&, int);
+
+  static ThreadedBinaryTree combine(ThreadedBinaryTree lhs, ThreadedBinaryTree rhs, SetOp op) {
+    static_assert(is_avl, "set operations are implemented for AvlBalance only");
+    lhs.share_allocator_with(rhs);
+
+    int depth = parallel_depth();
+
+    DropList dropped;
+    Node* a = lhs.release_root();
+    Node* b = rhs.release_root();
+    lhs.reset_root((lhs.*op)(a, b, dropped, depth));
+
+    for (Node* node = dropped.head; node != nullptr; ) {
+      Node* next = node->parent;
+      lhs.destroy_node(node);
+      node = next;
+    }
+    return lhs;
+  }
+
+  // Решает две независимые подзадачи; крупные - в двух потоках
+  template<typename LeftF, typename RightF>
+  std::pair<Node*, Node*> fork_join(size_t work, int depth, DropList& dropped,
+                                    LeftF left_task, RightF right_task) {
+    if (depth > 0 && work >= PARALLEL_CUTOFF) {
+      DropList left_dropped;
+      std::future<Node*> left_future;
+      try {
+        left_future = std::async(std::launch::async, [&] { return left_task(left_dropped, depth - 1); });
+      } catch (const std::system_error&) {
+        // Поток не запустился - считаем последовательно
+      }
+
+      if (left_future.valid()) {
+        Node* right = right_task(dropped, depth - 1);
+        Node* left  = left_future.get();
+        dropped.append(left_dropped);
+        return {left, right};
+      }
+    }
+
+    Node* left = left_task(dropped, 0);
+    return {left, right_task(dropped, 0)};
+  }
+
+  void drop_subtree(Node* node, DropList& dropped) {
+    if (node == nullptr) { return; }
+    Node* l = left_ptr(node);
+    Node* r = right_ptr(node);
+    drop_subtree(l, dropped);
+    drop_subtree(r, dropped);
+    dropped.push(node);
+  }
+
+  Node* union_nodes(Node* a, Node* b, DropList& dropped, int depth) {
+    if (a == nullptr) { return b; }
+    if (b == nullptr) { return a; }
+
+    size_t work = subtree_size(a) + subtree_size(b);
+    Node* al = detach(left_ptr(a));
+    Node* ar = detach(right_ptr(a));
+    SplitParts parts = split_nodes(b, a->data.first);
+    if (parts.mid != nullptr) { dropped.push(parts.mid); }
+
+    auto [l, r] = fork_join(work, depth, dropped,
+      [&](DropList& d, int dep) { return union_nodes(al, parts.left, d, dep); },
+      [&](DropList& d, int dep) { return union_nodes(ar, parts.right, d, dep); });
+
+    return join_nodes(l, a, r);
+  }
+
+  Node* intersection_nodes(Node* a, Node* b, DropList& dropped, int depth) {
+    if (a == nullptr || b == nullptr) {
+      drop_subtree(a, dropped);
+      drop_subtree(b, dropped);
+      return nullptr;
+    }
+
+    size_t work = subtree_size(a) + subtree_size(b);
+    Node* al = detach(left_ptr(a));
+    Node* ar = detach(right_ptr(a));
+    SplitParts parts = split_nodes(b, a->data.first);
+
+    auto [l, r] = fork_join(work, depth, dropped,
+      [&](DropList& d, int dep) { return intersection_nodes(al, parts.left, d, dep); },
+      [&](DropList& d, int dep) { return intersection_nodes(ar, parts.right, d, dep); });
+
+    if (parts.mid != nullptr) {
+      dropped.push(parts.mid);
+      return join_nodes(l, a, r);
+    }
+    dropped.push(a);
+    return join2_nodes(l, r);
+  }
+
+  Node* difference_nodes(Node* a, Node* b, DropList& dropped, int depth) {
+    if (a == nullptr || b == nullptr) {
+      drop_subtree(b, dropped);
+      return a;
+    }
+
+    size_t work = subtree_size(a) + subtree_size(b);
+    Node* bl = detach(left_ptr(b));
+    Node* br = detach(right_ptr(b));
+    SplitParts parts = split_nodes(a, b->data.first);
+
+    auto [l, r] = fork_join(work, depth, dropped,
+      [&](DropList& d, int dep) { return difference_nodes(parts.left, bl, d, dep); },
+      [&](DropList& d, int dep) { return difference_nodes(parts.right, br, d, dep); });
+
+    dropped.push(b);
+    if (parts.mid != nullptr) { dropped.push(parts.mid); }
+    return join2_nodes(l, r);
+  }
+
   Node* make_sentinel() {
-    Node* snt   = new Node{KeyT{}, ValueT{}};    
+    Node* snt   = create_node(KeyT{}, ValueT{});
     snt->height = 0;
+    snt->size   = 0;
     
     snt->left  = snt;
     snt->right = snt;
@@ -736,13 +2110,14 @@ private:
     }
   }
 
-  Node* copy() const {
+  // Копия узлов дерева, память под которые берется у аллокатора target
+  Node* copy(ThreadedBinaryTree& target) const {
     if (root_ == nullptr) { return nullptr; }
  
     std::unordered_map<const Node*, Node*> map;
 
-    auto visit = [&map](const Node* node) {
-      map[node] = new Node{node->data.first, node->data.second};
+    auto visit = [&map, &target](const Node* node) {
+      map[node] = target.create_node(node->data.first, node->data.second);
     };
     
     try {
@@ -750,6 +2125,8 @@ private:
 
       for (auto [node, copy_node] : map) {
         copy_node->height = node->height;
+        copy_node->size   = node->size;
+        copy_node->agg    = node->agg;
   
         copy_node->left  = (node->left  == sentinel_) ? nullptr : map[node->left];
         copy_node->right = (node->right == sentinel_) ? nullptr : map[node->right];
@@ -762,12 +2139,13 @@ private:
   
       return map[root_];
     } catch (...) {
-      for (auto [_, node] : map) { delete node; }
+      for (auto [_, node] : map) { target.destroy_node(node); }
       throw;
     }
   }
 
   void swap_with(ThreadedBinaryTree& other) noexcept {
+    std::swap(alloc_, other.alloc_);
     std::swap(root_, other.root_);
     std::swap(sentinel_, other.sentinel_);
     std::swap(comp_, other.comp_);
@@ -796,6 +2174,7 @@ private:
     // ---- sentinel basic sanity ----
     if (sentinel_ == nullptr) { return fail("validate failed: sentinel_ == nullptr"); }
     if (sentinel_->height != 0) { return fail("validate failed: sentinel_->height != 0"); }
+    if (sentinel_->size != 0)   { return fail("validate failed: sentinel_->size != 0"); }
 
     // Empty tree contract
     if (root_ == nullptr) {
@@ -809,7 +2188,7 @@ private:
     if (size_ == 0) { return fail("validate failed: root_ != nullptr but size_ == 0"); }
     if (root_->parent != nullptr) { return fail("validate failed: root_->parent != nullptr"); }
 
-    // ---- structural DFS checks: BST order, parent links, AVL height/balance ----
+    // ---- structural DFS checks: BST order, parent links, height/rank balance ----
     bool ok = true;
 
     std::function<int(const Node*, const KeyT*, const KeyT*)> dfs =
@@ -847,10 +2226,38 @@ private:
         if (!ok) { return 0; }
 
         int computed_h = (hl > hr ? hl : hr) + 1;
-        if (n->height != computed_h) { ok = false; dbgs("validate failed: height mismatch"); return 0; }
+        if constexpr (is_avl) {
+          if (n->height != computed_h) { ok = false; dbgs("validate failed: height mismatch"); return 0; }
+
+          int bf = hr - hl;
+          if (std::abs(bf) > 1) { ok = false; dbgs("validate failed: AVL balance factor violated"); return 0; }
+        } else {
+          int dl = n->height - height(L);
+          int dr = n->height - height(R);
+          if constexpr (is_wavl) {
+            if (dl < 1 || dl > 2 || dr < 1 || dr > 2) { ok = false; dbgs("validate failed: WAVL rank difference"); return 0; }
+            if (!L && !R && n->height != 1) { ok = false; dbgs("validate failed: WAVL leaf rank != 1"); return 0; }
+          } else {
+            if (dl < 0 || dl > 1 || dr < 0 || dr > 1) { ok = false; dbgs("validate failed: red-black rank difference"); return 0; }
+            if ((!L && dl != 1) || (!R && dr != 1)) { ok = false; dbgs("validate failed: red-black missing child is not black"); return 0; }
+            auto red_child = [&](const Node* c) {
+              return c && n->height == c->height;
+            };
+            auto has_red_child = [&](const Node* c) {
+              return red_child(c) && ((left_child(c) && left_child(c)->height == c->height) ||
+                                      (right_child(c) && right_child(c)->height == c->height));
+            };
+            if (has_red_child(L) || has_red_child(R)) { ok = false; dbgs("validate failed: red-black red node has red child"); return 0; }
+          }
+        }
 
-        int bf = hr - hl;
-        if (std::abs(bf) > 1) { ok = false; dbgs("validate failed: AVL balance factor violated"); return 0; }
+        size_t computed_size = (L ? L->size : 0) + (R ? R->size : 0) + 1;
+        if (n->size != computed_size) { ok = false; dbgs("validate failed: subtree size mismatch"); return 0; }
+
+        if constexpr (!mutable_values && std::equality_comparable<AggValue>) {
+          AggValue computed_agg = AggT::combine(AggT::combine(subtree_agg(L), lift(n)), subtree_agg(R));
+          if (!(n->agg == computed_agg)) { ok = false; dbgs("validate failed: subtree aggregate mismatch"); return 0; }
+        }
 
         return computed_h;
       };
@@ -918,6 +2325,7 @@ private:
   }
 #endif
 
+  NodeAlloc alloc_;
   Node* root_;
   Node* sentinel_;
   CompT comp_;
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace myds {
+
+// Дерево с версиями для одновременной работы читателей и писателя.
+// Читатель за O(1) берет snapshot() - неизменяемую опубликованную версию - и
+// спокойно ищет и обходит ее, пока писатель вставляет. Изменения копятся в
+// рабочей копии и становятся видны читателям после publish().
+// Старая версия освобождается, когда ее отпускает последний читатель (shared_ptr).
+//
+// Копирование пути невозможно: узлы прошитого дерева ссылаются на родителя и
+// соседей по нитям, поэтому версии - это целые деревья. Чтобы publish() не
+// копировал дерево каждый раз, версии меняются ролями: снятая с публикации версия
+// становится запасной и, как только ее отпускает последний читатель, превращается
+// в рабочую, догоняя текущую повтором журналов операций. Пока запасная занята,
+// изменения только пишутся в журнал, а insert/remove отвечают по опубликованной
+// версии и журналу.
+//
+// Копия O(n) под мьютексом писателя остается в одном случае: publish(), когда
+// запасную (версию двумя публикациями раньше) все еще держит читатель, то есть
+// читатель не обновлял снимок весь промежуток между публикациями (BM_VersionedPublish).
+template<typename TreeT>
+class VersionedTree {
+public:
+  using key_type    = typename TreeT::key_type;
+  using mapped_type = typename TreeT::mapped_type;
+  using Snapshot    = std::shared_ptr<const TreeT>;
+
+  VersionedTree() : VersionedTree(TreeT{}) {}
+
+  explicit VersionedTree(TreeT initial)
+    : current_(std::make_shared<TreeT>(initial)), working_(std::move(initial)) {}
+
+
+  // Текущая опубликованная версия, O(1). Потокобезопасно
+  Snapshot snapshot() const {
+    return current_.load(std::memory_order_acquire);
+  }
+
+  // Номер опубликованной версии (число вызовов publish())
+  size_t version() const {
+    return version_.load(std::memory_order_acquire);
+  }
+
+  // Изменения рабочей копии; читателям не видны до publish().
+  // Писатели сериализуются между собой
+  bool insert(const key_type& key, const mapped_type& value) {
+    std::lock_guard lock(writer_mutex_);
+    bool inserted = try_restore() ? working_.insert(key, value).second : !pending_contains(key);
+    if (inserted) { record({Op::Insert, key, value}); }
+    return inserted;
+  }
+
+  bool remove(const key_type& key) {
+    std::lock_guard lock(writer_mutex_);
+    bool removed = try_restore() ? working_.remove(key) : pending_contains(key);
+    if (removed) { record({Op::Remove, key, mapped_type{}}); }
+    return removed;
+  }
+
+  // Публикует накопленные изменения как новую версию
+  void publish() {
+    std::lock_guard lock(writer_mutex_);
+
+    if (!try_restore()) {
+      // Запасную версию все еще читают: рабочая строится копией, O(n)
+      working_ = *current_.load(std::memory_order_relaxed);
+      replay(log_);
+      drop_spare();
+    }
+
+    auto next = std::make_shared<TreeT>(std::move(working_));
+    spare_ = current_.exchange(next, std::memory_order_acq_rel);
+    version_.fetch_add(1, std::memory_order_release);
+
+    spare_log_ = std::move(log_);
+    log_.clear();
+    try_restore();
+  }
+
+private:
+  struct Op {
+    enum Kind { Insert, Remove };
+
+    Kind kind;
+    key_type key;
+    mapped_type value;
+  };
+
+  // Делает рабочую копию актуальной, если ее еще нет, а запасную версию уже
+  // никто не читает. false - рабочей копии нет, состояние = текущая версия + log_
+  bool try_restore() {
+    if (spare_ == nullptr) { return true; }
+
+    // После exchange новых читателей у запасной версии не появится; use_count() == 1
+    // значит, что старые ее отпустили. Барьер синхронизируется с их release
+    if (spare_.use_count() != 1) { return false; }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    working_ = std::move(*spare_);
+    replay(spare_log_);
+    replay(log_);
+    drop_spare();
+    return true;
+  }
+
+  void drop_spare() {
+    spare_.reset();
+    spare_log_.clear();
+    pending_.clear();
+  }
+
+  void record(const Op& op) {
+    log_.push_back(op);
+    if (spare_ != nullptr) { pending_[op.key] = (op.kind == Op::Insert); }
+  }
+
+  // Есть ли ключ в состоянии "текущая версия + log_" (когда рабочей копии нет)
+  bool pending_contains(const key_type& key) const {
+    if (auto it = pending_.find(key); it != pending_.end()) { return it->second; }
+    const TreeT& current = *current_.load(std::memory_order_relaxed);
+    return current.find(key) != current.end();
+  }
+
+  void replay(const std::vector<Op>& log) {
+    for (const Op& op : log) {
+      if (op.kind == Op::Insert) {
+        working_.insert(op.key, op.value);
+      } else {
+        working_.remove(op.key);
+      }
+    }
+  }
+
+  std::atomic<std::shared_ptr<TreeT>> current_;
+  std::atomic<size_t> version_{0};
+
+  std::mutex writer_mutex_;
+  TreeT working_;
+  std::vector<Op> log_;  // изменения после текущей версии
+
+  // Снятая с публикации версия и журнал, переводящий ее в текущую.
+  // Пока spare_ != nullptr, working_ не используется
+  std::shared_ptr<TreeT> spare_;
+  std::vector<Op> spare_log_;
+
+  // Итог log_ по ключам (true - ключ есть), пока нет рабочей копии
+  std::map<key_type, bool, typename TreeT::key_compare> pending_;
+};
+
+} // namespace myds
@@ -1,22 +1,128 @@
+#include <string>
+#include <thread>
+#include <charconv>
 #include <iostream>
+#include <optional>
+#include <string_view>
 
 #include "tree.hpp"
+#include "compact_tree.hpp"
+#include "interval_tree.hpp"
 #include "range_query.hpp"
+#include "batch_query.hpp"
+#include "fast_io.hpp"
 
 using namespace myds;
 using namespace rq;
 
-int main() {
-  ThreadedBinaryTree<int, int> tree;
+// Значение элемента равно ключу. Пока приходят только k и q, узлы не хранят агрегатов;
+// на первой команде s или m дерево перестраивается в AggTree с суммой и максимумом поддерева
+using Tree = ThreadedBinaryTree<int, int>;
+using AggTree = ThreadedBinaryTree<
+  int, int, std::less<int>, PairAggregate<SumAggregate<long long>, MaxAggregate<int>>
+>;
 
-  char command = '\0';
+// С --compact ключи до первой s/m лежат в CompactThreadedTree: 24 байта на узел вместо 48
+using CompactTree = CompactThreadedTree<int, int>;
+
+// Отрезки [L, R] с максимумом правых концов в узлах для команд i и o
+using Intervals = IntervalTree<int>;
+
+// Обычный или пакетный режим; результат - как у RangeQuery::run
+template <typename TreeT>
+static char serve(TreeT& tree, FastReader& in, FastWriter& out, bool batch, size_t threads,
+                  char command = '\0') {
+  if (batch) { return BatchRangeQuery<TreeT>(threads).run(tree, in, out, command); }
+  return RangeQuery<TreeT>::run(tree, in, out, command);
+}
+
+// Команды k/q/s/m до конца ввода: сначала на TreeT, с первой s/m - на AggTree
+template <typename TreeT>
+static void serve_keys(FastReader& in, FastWriter& out, bool batch, size_t threads) {
+  TreeT tree;
+  char command = serve(tree, in, out, batch, threads);
+  if (command != '\0') {
+    AggTree agg_tree = AggTree::from_sorted(tree.begin(), tree.end());
+    tree = TreeT();
+    serve(agg_tree, in, out, batch, threads, command);
+  }
+}
+
+// Число потоков для --threads: целое от 1 до MAX_THREADS без знака и лишних символов
+static constexpr size_t MAX_THREADS = 1024;
+
+static std::optional<size_t> parse_threads(std::string_view arg) {
+  size_t threads = 0;
+  auto [ptr, ec] = std::from_chars(arg.data(), arg.data() + arg.size(), threads);
+  if (ec != std::errc() || ptr != arg.data() + arg.size() || threads == 0 || threads > MAX_THREADS) {
+    return std::nullopt;
+  }
+  return threads;
+}
+
+static int usage(const char* prog) {
+  std::cerr << "Usage: " << prog << " [--compact] [--batch [--threads N]] | --intervals" << std::endl;
+  return 1;
+}
+
+// rq [--compact] [--batch [--threads N]] | --intervals
+// В пакетном режиме запросы между вставками решаются параллельно на N потоках
+// (по умолчанию - по числу ядер, --threads допустим только вместе с --batch);
+// вывод тот же, что и в обычном режиме.
+// С --compact ключи хранятся в компактном дереве (до первой команды s или m).
+// В режиме --intervals вместо ключей хранятся отрезки (команды i и o)
+int main(int argc, char* argv[]) {
+  bool batch = false;
+  bool compact = false;
+  bool intervals = false;
+  bool threads_set = false;
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
 
   try {
-    while (std::cin >> command) {
-      if (command == 'e') { break; }
-      RangeQuery<ThreadedBinaryTree<int, int>>::process_command(tree, command, std::cin, std::cout);
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "--batch") {
+        batch = true;
+      } else if (arg == "--compact") {
+        compact = true;
+      } else if (arg == "--intervals") {
+        intervals = true;
+      } else if (arg == "--threads" && i + 1 < argc) {
+        auto parsed = parse_threads(argv[++i]);
+        if (!parsed) { return usage(argv[0]); }
+        threads = *parsed;
+        threads_set = true;
+      } else {
+        return usage(argv[0]);
+      }
+    }
+    if ((intervals && (batch || compact)) || (threads_set && !batch)) { return usage(argv[0]); }
+  } catch(const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ios::sync_with_stdio(false);
+  FastReader in(std::cin);
+  FastWriter out(std::cout);
+
+  try {
+    if (intervals) {
+      Intervals interval_tree;
+      char command = '\0';
+      while (in >> command && command != 'e') {
+        IntervalQuery<Intervals>::process_command(interval_tree, command, in, out);
+      }
+      return 0;
+    }
+
+    if (compact) {
+      serve_keys<CompactTree>(in, out, batch, threads);
+    } else {
+      serve_keys<Tree>(in, out, batch, threads);
     }
   } catch(const std::exception& e) {
+    out.flush();
     std::cerr << "Error: " << e.what() << std::endl;
     return 1;
   }
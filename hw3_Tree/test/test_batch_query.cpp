@@ -0,0 +1,108 @@
+#include <string>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "tree.hpp"
+#include "aggregate.hpp"
+#include "range_query.hpp"
+#include "batch_query.hpp"
+
+using namespace myds;
+using namespace rq;
+
+using Tree = ThreadedBinaryTree<
+    int, int, std::less<int>, PairAggregate<SumAggregate<long long>, MaxAggregate<int>>
+>;
+
+// Эталон - поочередный RangeQuery::process_command; при ошибке возвращает вывод до нее
+static std::string run_sequential(const std::string& input, bool& failed) {
+    Tree tree;
+    std::istringstream in(input);
+    std::ostringstream out;
+    failed = false;
+    try {
+        char command = '\0';
+        while (in >> command && command != 'e') {
+            RangeQuery<Tree>::process_command(tree, command, in, out);
+        }
+    } catch (const std::exception&) {
+        failed = true;
+    }
+    return out.str();
+}
+
+static std::string run_batch(const std::string& input, size_t threads, bool& failed) {
+    Tree tree;
+    std::istringstream in(input);
+    std::ostringstream out;
+    failed = false;
+    try {
+        BatchRangeQuery<Tree>(threads).run(tree, in, out);
+    } catch (const std::exception&) {
+        failed = true;
+    }
+    return out.str();
+}
+
+static void expect_same(const std::string& input) {
+    bool seq_failed = false;
+    std::string expected = run_sequential(input, seq_failed);
+    for (size_t threads : {1, 4}) {
+        bool batch_failed = false;
+        EXPECT_EQ(run_batch(input, threads, batch_failed), expected) << "threads = " << threads;
+        EXPECT_EQ(batch_failed, seq_failed) << "threads = " << threads;
+    }
+}
+
+// keys вставок, затем серии по run_length запросов q/s/m вперемешку с одиночными k
+static std::string make_input(int keys, int runs, int run_length, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> key(-100'000, 100'000);
+    std::uniform_int_distribution<int> width(-100, 50'000);
+    const char commands[] = {'q', 's', 'm'};
+
+    std::ostringstream in;
+    for (int i = 0; i < keys; ++i) { in << "k " << key(rng) << '\n'; }
+    for (int r = 0; r < runs; ++r) {
+        for (int i = 0; i < run_length; ++i) {
+            int left = key(rng);
+            in << commands[rng() % 3] << ' ' << left << ' ' << left + width(rng) << '\n';
+        }
+        in << "k " << key(rng) << '\n';
+    }
+    return in.str();
+}
+
+// Серии короче порога параллельного решения (256) решаются в вызывающем потоке
+TEST(BatchRangeQuery, ShortRunsMatchSequential) {
+    expect_same(make_input(500, 50, 7, 1));
+    expect_same(make_input(500, 20, 255, 2));
+}
+
+TEST(BatchRangeQuery, LongRunsMatchSequential) {
+    expect_same(make_input(500, 5, 257, 3));
+    expect_same(make_input(500, 3, 5'000, 4));
+}
+
+// Серия длиннее MAX_BATCH (2^16) делится на несколько пакетов
+TEST(BatchRangeQuery, RunOverMaxBatchMatchesSequential) {
+    expect_same(make_input(500, 1, 70'000, 5));
+}
+
+TEST(BatchRangeQuery, StopsAtEndCommand) {
+    expect_same("k 10 k 20 q 0 30 s 0 30 m 0 15 e k 40 q 0 100");
+}
+
+// Ответы на прочитанные до ошибки запросы выводятся до исключения
+TEST(BatchRangeQuery, ErrorKeepsPartialAnswers) {
+    std::string input = make_input(500, 1, 300, 6);
+    expect_same(input + "x 1 2\nq 0 10\n");
+    expect_same(input + "q 1\n");
+
+    bool failed = false;
+    EXPECT_EQ(run_batch("k 5 q 0 10 m 0 10 x", 4, failed), "1 5 ");
+    EXPECT_TRUE(failed);
+}
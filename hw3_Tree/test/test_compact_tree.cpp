@@ -0,0 +1,139 @@
+#include <map>
+#include <string>
+#include <random>
+#include <vector>
+#include <iterator>
+#include <stdexcept>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "tree.hpp"
+#include "compact_tree.hpp"
+
+using namespace myds;
+
+TEST(CompactThreadedTree, InsertFindSimple) {
+    CompactThreadedTree<int, std::string> tree;
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.begin(), tree.end());
+
+    EXPECT_TRUE(tree.insert(5, "five").second);
+    EXPECT_TRUE(tree.insert(3, "three").second);
+    EXPECT_TRUE(tree.insert(7, "seven").second);
+    auto [it, inserted] = tree.insert(5, "five again");
+    EXPECT_FALSE(inserted);
+    EXPECT_EQ(it->second, "five");
+
+    EXPECT_EQ(tree.size(), 3);
+    EXPECT_EQ(tree.at(3), "three");
+    EXPECT_TRUE(tree.contains(7));
+    EXPECT_EQ(tree.find(42), tree.end());
+    EXPECT_THROW(tree.at(42), std::out_of_range);
+
+    tree.clear();
+    EXPECT_TRUE(tree.empty());
+    EXPECT_TRUE(tree.insert(1, "one").second);
+    EXPECT_EQ(tree.begin()->first, 1);
+}
+
+TEST(CompactThreadedTree, SortedInsertIterates) {
+    CompactThreadedTree<int, int> tree;
+    for (int i = 0; i < 1000; ++i) { tree.insert(i, -i); }
+
+    int expected = 0;
+    for (const auto& [key, value] : tree) {
+        EXPECT_EQ(key, expected);
+        EXPECT_EQ(value, -expected);
+        ++expected;
+    }
+    EXPECT_EQ(expected, 1000);
+
+    expected = 999;
+    for (auto it = tree.rbegin(); it != tree.rend(); ++it) {
+        EXPECT_EQ(it->first, expected--);
+    }
+    EXPECT_EQ(std::prev(tree.end())->first, 999);
+}
+
+// Случайные вставки сверяются с std::map: поиск, границы, ранги и диапазоны
+TEST(CompactThreadedTree, MatchesStdMap) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> key(-5'000, 5'000);
+
+    CompactThreadedTree<int, int> tree;
+    std::map<int, int> ref;
+    for (int i = 0; i < 3'000; ++i) {
+        int k = key(rng);
+        EXPECT_EQ(tree.insert(k, i).second, ref.emplace(k, i).second);
+    }
+    ASSERT_EQ(tree.size(), ref.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), ref.begin(), ref.end()));
+
+    for (int i = 0; i < 2'000; ++i) {
+        int lo = key(rng);
+        int hi = lo + key(rng) / 10;
+
+        auto lb = tree.lower_bound(lo);
+        auto ref_lb = ref.lower_bound(lo);
+        ASSERT_EQ(lb == tree.end(), ref_lb == ref.end());
+        if (ref_lb != ref.end()) { EXPECT_EQ(lb->first, ref_lb->first); }
+
+        auto ub = tree.upper_bound(lo);
+        auto ref_ub = ref.upper_bound(lo);
+        ASSERT_EQ(ub == tree.end(), ref_ub == ref.end());
+        if (ref_ub != ref.end()) { EXPECT_EQ(ub->first, ref_ub->first); }
+
+        EXPECT_EQ(tree.rank(lo), static_cast<size_t>(std::distance(ref.begin(), ref_lb)));
+
+        size_t expected = hi < lo ? 0 : std::distance(ref.lower_bound(lo), ref.upper_bound(hi));
+        EXPECT_EQ(tree.count_range(lo, hi), expected) << lo << ' ' << hi;
+        EXPECT_EQ(tree.contains(lo), ref.contains(lo));
+    }
+}
+
+// Тот же набор, что и ThreadedBinaryTree, можно перенести в полное дерево
+TEST(CompactThreadedTree, ConvertsToThreadedBinaryTree) {
+    CompactThreadedTree<int, int> compact;
+    for (int i = 100; i > 0; --i) { compact.insert(i * 3, i); }
+
+    auto tree = ThreadedBinaryTree<int, int>::from_sorted(compact.begin(), compact.end());
+    EXPECT_EQ(tree.size(), 100);
+    EXPECT_EQ(tree.count_range(10, 30), compact.count_range(10, 30));
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), compact.begin(), compact.end()));
+}
+
+namespace {
+size_t allocated_bytes = 0;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template <typename U> CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        allocated_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* ptr, size_t n) {
+        allocated_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    bool operator==(const CountingAllocator&) const { return true; }
+};
+}
+
+// Узел <int, int> - 24 байта: ключ, значение, две ссылки, размер и байт высоты
+TEST(CompactThreadedTree, NodeIsTwentyFourBytes) {
+    allocated_bytes = 0;
+    {
+        CompactThreadedTree<int, int, std::less<int>, CountingAllocator<std::pair<const int, int>>> tree;
+        tree.reserve(1'000);
+        for (int i = 0; i < 1'000; ++i) { tree.insert(i * 7 % 1'000, i); }
+        EXPECT_EQ(allocated_bytes, 24'000);
+    }
+    EXPECT_EQ(allocated_bytes, 0);
+}
@@ -0,0 +1,136 @@
+#include <string>
+#include <random>
+#include <vector>
+#include <sstream>
+#include <climits>
+
+#include <gtest/gtest.h>
+
+#include "fast_io.hpp"
+
+using namespace rq;
+
+// Читает пары (команда, число) до ошибки; так же разбирается вход rq
+template <typename In>
+static std::vector<std::pair<char, int>> read_all(In& in) {
+    std::vector<std::pair<char, int>> res;
+    char command = '\0';
+    int x = 0;
+    while (in >> command >> x) { res.push_back({command, x}); }
+    return res;
+}
+
+static std::vector<std::pair<char, int>> read_fast(const std::string& input, size_t block) {
+    std::istringstream stream(input);
+    FastReader in(stream, block);
+    return read_all(in);
+}
+
+static std::vector<std::pair<char, int>> read_istream(const std::string& input) {
+    std::istringstream in(input);
+    return read_all(in);
+}
+
+TEST(FastReader, ExplicitPlusAndMinus) {
+    std::istringstream stream("k +42 k -7 k +0");
+    FastReader in(stream);
+    char command = '\0';
+    int x = 0;
+    EXPECT_TRUE(in >> command >> x);
+    EXPECT_EQ(x, 42);
+    EXPECT_TRUE(in >> command >> x);
+    EXPECT_EQ(x, -7);
+    EXPECT_TRUE(in >> command >> x);
+    EXPECT_EQ(x, 0);
+    EXPECT_FALSE(in >> command);
+}
+
+TEST(FastReader, MalformedNumberFails) {
+    for (const char* input : {"k +", "k +-1", "k -", "k x"}) {
+        std::istringstream stream(input);
+        FastReader in(stream);
+        char command = '\0';
+        int x = 0;
+        EXPECT_FALSE(in >> command >> x) << input;
+    }
+}
+
+TEST(FastReader, OverflowFails) {
+    std::istringstream stream("k 2147483647 k 2147483648 k 1");
+    FastReader in(stream);
+    char command = '\0';
+    int x = 0;
+    EXPECT_TRUE(in >> command >> x);
+    EXPECT_EQ(x, INT_MAX);
+    EXPECT_FALSE(in >> command >> x);
+    EXPECT_FALSE(in >> command);
+}
+
+TEST(FastReader, EofWithoutTrailingNewline) {
+    std::istringstream stream("q 1 23");
+    FastReader in(stream);
+    char command = '\0';
+    int left = 0;
+    int right = 0;
+    EXPECT_TRUE(in >> command >> left >> right);
+    EXPECT_EQ(command, 'q');
+    EXPECT_EQ(left, 1);
+    EXPECT_EQ(right, 23);
+    EXPECT_FALSE(in >> command);
+}
+
+// Число с ведущими нулями длиннее запаса в 32 символа и длиннее самого блока
+TEST(FastReader, LongTokenAcrossBlocks) {
+    std::string zeros(100, '0');
+    std::string input = "k " + zeros + "42 k -" + zeros + "7 k 5";
+    std::vector<std::pair<char, int>> expected = {{'k', 42}, {'k', -7}, {'k', 5}};
+    ASSERT_EQ(read_istream(input), expected);
+    for (size_t block : {1, 3, 16, 64, 1 << 16}) {
+        EXPECT_EQ(read_fast(input, block), expected) << "block = " << block;
+    }
+}
+
+TEST(FastReader, TokensStraddleBlocks) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> value(INT_MIN, INT_MAX);
+    std::ostringstream input;
+    const char* spaces[] = {" ", "\n", "  \t", "\r\n"};
+    for (int i = 0; i < 2'000; ++i) {
+        long long x = value(rng);
+        input << "kqsm"[rng() % 4] << spaces[rng() % 4];
+        if (x < 0) {
+            input << '-';
+        } else if (rng() % 2 == 0) {
+            input << '+';
+        }
+        input << std::string(rng() % 3, '0') << (x < 0 ? -x : x) << spaces[rng() % 4];
+    }
+
+    auto expected = read_istream(input.str());
+    ASSERT_EQ(expected.size(), 2'000u);
+    for (size_t block : {1, 2, 5, 7, 31, 32, 33, 4096}) {
+        EXPECT_EQ(read_fast(input.str(), block), expected) << "block = " << block;
+    }
+}
+
+TEST(FastWriter, FlushesInDestructor) {
+    std::ostringstream out;
+    {
+        FastWriter writer(out, 8);
+        writer << 123456789 << ' ' << -42LL << ' ' << "none " << 'x';
+        EXPECT_EQ(out.str().find('x'), std::string::npos);
+    }
+    EXPECT_EQ(out.str(), "123456789 -42 none x");
+}
+
+TEST(FastWriter, LongStringBypassesBuffer) {
+    std::ostringstream out;
+    std::string text(100, 'a');
+    {
+        FastWriter writer(out, 16);
+        writer << 7 << ' ' << text.c_str() << ' ' << 8;
+        writer.flush();
+        EXPECT_EQ(out.str(), "7 " + text + " 8");
+    }
+    EXPECT_EQ(out.str(), "7 " + text + " 8");
+}
@@ -0,0 +1,66 @@
+#include <string>
+#include <random>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "interval_tree.hpp"
+
+using namespace myds;
+
+TEST(IntervalTree, ForEachOverlap) {
+    IntervalTree<int, std::string> tree;
+    EXPECT_TRUE(tree.insert(1, 3, "a"));
+    EXPECT_TRUE(tree.insert(2, 8, "b"));
+    EXPECT_TRUE(tree.insert(5, 6, "c"));
+    EXPECT_TRUE(tree.insert(10, 12, "d"));
+    EXPECT_FALSE(tree.insert(5, 6, "dup"));
+    EXPECT_THROW(tree.insert(4, 3), std::invalid_argument);
+
+    std::string names;
+    tree.for_each_overlap(3, 5, [&](const auto& item) { names += item.second; });
+    EXPECT_EQ(names, "abc");
+
+    // Концы включаются
+    EXPECT_EQ(tree.count_overlaps(8, 10), 2);
+    EXPECT_EQ(tree.count_overlaps(9, 9), 0);
+    EXPECT_EQ(tree.count_overlaps(5, 4), 0);
+    EXPECT_TRUE(tree.overlaps(12, 100));
+    EXPECT_FALSE(tree.overlaps(13, 100));
+
+    EXPECT_TRUE(tree.remove(2, 8));
+    EXPECT_FALSE(tree.remove(2, 8));
+    EXPECT_EQ(tree.count_overlaps(4, 9), 1);
+}
+
+TEST(IntervalTree, MatchesBruteForce) {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> start(0, 10'000);
+    std::uniform_int_distribution<int> length(0, 300);
+
+    IntervalTree<int> tree;
+    std::vector<std::pair<int, int>> all;
+    for (int i = 0; i < 3'000; ++i) {
+        int lo = start(gen);
+        int hi = lo + (i % 50 == 0 ? 5'000 : length(gen));
+        if (tree.insert(lo, hi)) { all.emplace_back(lo, hi); }
+    }
+
+    for (int i = 0; i < 500; ++i) {
+        int l = start(gen);
+        int r = l + length(gen);
+
+        std::vector<std::pair<int, int>> expected;
+        for (const auto& [lo, hi] : all) {
+            if (lo <= r && hi >= l) { expected.emplace_back(lo, hi); }
+        }
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<std::pair<int, int>> found;
+        tree.for_each_overlap(l, r, [&](const auto& item) { found.push_back(item.first); });
+        ASSERT_EQ(found, expected) << "query [" << l << ", " << r << "]";
+    }
+}
@@ -0,0 +1,60 @@
+#include <string>
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "tree.hpp"
+#include "aggregate.hpp"
+#include "range_query.hpp"
+
+using namespace myds;
+using namespace rq;
+
+using PlainTree = ThreadedBinaryTree<int, int>;
+using AggTree = ThreadedBinaryTree<
+    int, int, std::less<int>, PairAggregate<SumAggregate<long long>, MaxAggregate<int>>
+>;
+
+template <typename TreeT>
+static std::string run_all(TreeT& tree, const std::string& input) {
+    std::istringstream in(input);
+    std::ostringstream out;
+    char command = '\0';
+    while (in >> command && command != 'e') {
+        RangeQuery<TreeT>::process_command(tree, command, in, out);
+    }
+    return out.str();
+}
+
+TEST(RangeQuery, PlainTreeAnswersCount) {
+    PlainTree tree;
+    EXPECT_EQ(run_all(tree, "k 10 k 20 q 8 31 q 6 9 k 30 k 40 q 15 40 q 5 5"), "2 0 3 0 ");
+
+    std::istringstream in("1 2");
+    std::ostringstream out;
+    EXPECT_THROW(RangeQuery<PlainTree>::process_command(tree, 's', in, out), std::invalid_argument);
+    EXPECT_THROW(RangeQuery<PlainTree>::answer(tree, 'm', 1, 2), std::invalid_argument);
+}
+
+TEST(RangeQuery, AggTreeAnswersAggregates) {
+    AggTree tree;
+    EXPECT_EQ(run_all(tree, "k 10 k 20 k 30 s 5 25 m 5 25 m 21 29 s 30 10 q 1 100"), "30 20 none 0 3 ");
+}
+
+// Простое дерево останавливается на первой s/m, не читая ее границ;
+// агрегирующее, построенное по нему, продолжает с той же команды
+TEST(RangeQuery, RunStopsOnAggregateCommand) {
+    std::istringstream in("k 1 k 5 q 0 9 s 0 9 k 7 m 0 6 q 0 9 e k 100");
+    std::ostringstream out;
+
+    PlainTree plain;
+    char command = RangeQuery<PlainTree>::run(plain, in, out);
+    EXPECT_EQ(command, 's');
+    EXPECT_EQ(out.str(), "2 ");
+
+    AggTree tree = AggTree::from_sorted(plain.begin(), plain.end());
+    EXPECT_EQ(RangeQuery<AggTree>::run(tree, in, out, command), '\0');
+    EXPECT_EQ(out.str(), "2 6 5 3 ");
+    EXPECT_EQ(tree.size(), 3u);
+}
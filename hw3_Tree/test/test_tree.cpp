@@ -1,5 +1,12 @@
+#include <map>
 #include <string>
+#include <string_view>
+#include <random>
+#include <vector>
 #include <iterator>
+#include <optional>
+#include <algorithm>
+#include <memory_resource>
 
 #include <gtest/gtest.h>
 
@@ -7,6 +14,29 @@
 
 using namespace myds;
 
+// Источник памяти для пула узлов, считающий живые блоки: по нему видно,
+// что память пулов возвращается
+class CountingResource : public std::pmr::memory_resource {
+public:
+    long blocks = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override {
+        void* ptr = std::pmr::new_delete_resource()->allocate(bytes, align);
+        ++blocks;
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t align) override {
+        --blocks;
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
 TEST(ThreadedBinaryTree, InsertFindSimple) {
     ThreadedBinaryTree<int, std::string> tree;
     EXPECT_TRUE(tree.insert(5, "five").second);
@@ -344,3 +374,611 @@ TEST(ThreadedBinaryTree, SizeAfterCopyAndMove) {
     move_assigned = std::move(assigned);
     EXPECT_EQ(move_assigned.size(), 3);
 }
+
+TEST(ThreadedBinaryTree, RankAndCountRange) {
+    ThreadedBinaryTree<int, int> tree;
+    for (int key : {10, 5, 15, 3, 7, 12, 20}) {
+        tree.insert(key, key);
+    }
+
+    // Inorder: 3, 5, 7, 10, 12, 15, 20
+    EXPECT_EQ(tree.rank(3), 0);
+    EXPECT_EQ(tree.rank(4), 1);
+    EXPECT_EQ(tree.rank(10), 3);
+    EXPECT_EQ(tree.rank(100), 7);
+
+    EXPECT_EQ(tree.count_range(5, 12), 4);
+    EXPECT_EQ(tree.count_range(6, 11), 2);
+    EXPECT_EQ(tree.count_range(21, 30), 0);
+    EXPECT_EQ(tree.count_range(12, 5), 0);
+    EXPECT_EQ(tree.count_range(7, 7), 1);
+}
+
+TEST(ThreadedBinaryTree, CountRangeMatchesDistanceAfterRemovals) {
+    ThreadedBinaryTree<int, int> tree;
+    for (int i = 0; i < 200; ++i) {
+        tree.insert((i * 37) % 200, i);
+    }
+    for (int i = 0; i < 200; i += 3) {
+        tree.remove((i * 11) % 200);
+    }
+
+    for (int lo = -5; lo < 205; lo += 7) {
+        for (int hi = lo; hi < 205; hi += 13) {
+            auto expected = std::distance(tree.lower_bound(lo), tree.upper_bound(hi));
+            EXPECT_EQ(tree.count_range(lo, hi), static_cast<size_t>(expected));
+        }
+    }
+}
+
+TEST(ThreadedBinaryTree, PoolReusesFreedNodes) {
+    ThreadedBinaryTree<int, std::string> tree;
+    for (int i = 0; i < 100; ++i) {
+        tree.insert(i, std::to_string(i));
+    }
+    const auto* first = &*tree.find(42);
+    tree.remove(42);
+
+    // Освобожденный узел уходит во free list и выдается следующей вставке
+    auto [it, inserted] = tree.insert(1000, "thousand");
+    ASSERT_TRUE(inserted);
+    EXPECT_EQ(&*it, first);
+    EXPECT_EQ(tree.at(1000), "thousand");
+}
+
+TEST(ThreadedBinaryTree, CopyGetsOwnPool) {
+    ThreadedBinaryTree<int, std::string> tree;
+    for (int i = 0; i < 50; ++i) {
+        tree.insert(i, std::to_string(i));
+    }
+
+    ThreadedBinaryTree<int, std::string> copy(tree);
+    EXPECT_TRUE(copy.get_allocator() != tree.get_allocator());
+
+    // Копия переживает оригинал: ее узлы лежат в собственном пуле
+    tree = ThreadedBinaryTree<int, std::string>{};
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(copy.at(i), std::to_string(i));
+    }
+}
+
+TEST(ThreadedBinaryTree, StdAllocator) {
+    using Tree = ThreadedBinaryTree<int, std::string, std::less<int>,
+                                    NoAggregate, AvlBalance, std::allocator<std::pair<const int, std::string>>>;
+    Tree tree;
+    for (int i = 0; i < 100; ++i) {
+        tree.insert(i, std::to_string(i));
+    }
+    for (int i = 0; i < 100; i += 2) {
+        tree.remove(i);
+    }
+
+    Tree copy(tree);
+    EXPECT_EQ(copy.size(), 50);
+    EXPECT_EQ(copy.at(51), "51");
+}
+
+TEST(ThreadedBinaryTree, FromSorted) {
+    std::vector<std::pair<int, std::string>> items;
+    for (int i = 0; i < 100; ++i) {
+        items.emplace_back(i * 2, std::to_string(i));
+    }
+
+    auto tree = ThreadedBinaryTree<int, std::string>::from_sorted(items.begin(), items.end());
+    EXPECT_EQ(tree.size(), 100);
+    EXPECT_EQ(tree.at(42), "21");
+    EXPECT_EQ(tree.count_range(10, 20), 6);
+
+    std::vector<int> keys;
+    for (auto it = tree.rbegin(); it != tree.rend(); ++it) {
+        keys.push_back(it->first);
+    }
+    EXPECT_EQ(keys.size(), 100);
+    EXPECT_TRUE(std::is_sorted(keys.rbegin(), keys.rend()));
+
+    // Дерево после построения остается рабочим
+    tree.insert(1, "one");
+    EXPECT_TRUE(tree.remove(100));
+    EXPECT_EQ(tree.size(), 100);
+    EXPECT_EQ(tree.rank(3), 3);
+}
+
+TEST(ThreadedBinaryTree, AssignSortedSkipsDuplicates) {
+    ThreadedBinaryTree<int, int> tree;
+    tree.insert(100, 100);
+
+    std::vector<std::pair<int, int>> items = {{1, 1}, {1, 2}, {3, 3}, {5, 5}, {5, 6}, {7, 7}};
+    tree.assign_sorted(items.begin(), items.end());
+
+    EXPECT_EQ(tree.size(), 4);
+    EXPECT_EQ(tree.at(1), 1);
+    EXPECT_EQ(tree.at(5), 5);
+    EXPECT_EQ(tree.find(100), tree.end());
+
+    tree.assign_sorted(items.end(), items.end());
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.begin(), tree.end());
+}
+
+TEST(ThreadedBinaryTree, SplitAndJoin) {
+    ThreadedBinaryTree<int, int> tree;
+    for (int i = 0; i < 100; ++i) {
+        tree.insert(i * 2, i);
+    }
+
+    auto right = tree.split(50);
+    EXPECT_EQ(tree.size(), 25);
+    EXPECT_EQ(right.size(), 75);
+    EXPECT_EQ(std::prev(tree.end())->first, 48);
+    EXPECT_EQ(right.begin()->first, 50);
+
+    right.remove(50);
+    auto joined = ThreadedBinaryTree<int, int>::join(std::move(tree), 49, -1, std::move(right));
+    EXPECT_EQ(joined.size(), 100);
+    EXPECT_EQ(joined.at(49), -1);
+    EXPECT_EQ(joined.rank(52), 26);
+
+    std::vector<int> keys;
+    for (auto it = joined.rbegin(); it != joined.rend(); ++it) {
+        keys.push_back(it->first);
+    }
+    EXPECT_TRUE(std::is_sorted(keys.rbegin(), keys.rend()));
+
+    // Части разделяют пул исходного дерева и остаются рабочими
+    auto tail = joined.split(1000);
+    EXPECT_TRUE(tail.empty());
+    tail.insert(1000, 0);
+    EXPECT_EQ(tail.size(), 1);
+}
+
+TEST(ThreadedBinaryTree, SetOperations) {
+    // Достаточно крупные деревья, чтобы задействовать параллельную ветку
+    std::vector<std::pair<int, int>> evens, threes;
+    for (int i = 0; i < 30000; ++i) {
+        evens.emplace_back(i * 2, 0);
+        threes.emplace_back(i * 3, 1);
+    }
+
+    using Tree = ThreadedBinaryTree<int, int>;
+    auto make_a = [&] { return Tree::from_sorted(evens.begin(), evens.end()); };
+    auto make_b = [&] { return Tree::from_sorted(threes.begin(), threes.end()); };
+
+    auto united = Tree::set_union(make_a(), make_b());
+    EXPECT_EQ(united.size(), 30000 + 30000 - 10000);
+    EXPECT_EQ(united.at(6), 0);
+    EXPECT_EQ(united.at(9), 1);
+
+    auto common = Tree::set_intersection(make_a(), make_b());
+    EXPECT_EQ(common.size(), 10000);
+    for (const auto& [key, value] : common) {
+        ASSERT_EQ(key % 6, 0);
+        ASSERT_EQ(value, 0);
+    }
+
+    auto diff = Tree::set_difference(make_a(), make_b());
+    EXPECT_EQ(diff.size(), 20000);
+    EXPECT_EQ(diff.count_range(0, 12), 4);  // 2, 4, 8, 10
+
+    // Результат - обычное дерево
+    diff.insert(6, 6);
+    EXPECT_TRUE(diff.remove(2));
+    EXPECT_EQ(diff.rank(7), 2);
+}
+
+TEST(ThreadedBinaryTree, SetOperationsCrossedPools) {
+    using Tree = ThreadedBinaryTree<int, int>;
+    CountingResource upstream;
+    {
+        Tree x{Tree::allocator_type(&upstream)};
+        Tree z{Tree::allocator_type(&upstream)};
+        for (int i = 0; i < 100; ++i) {
+            x.insert(i, i);
+            z.insert(i + 1000, i);
+        }
+
+        // y делит пул с x, а w - с z: второе объединение связывает те же два пула
+        // в обратном порядке и раньше замыкало их владение друг другом
+        Tree y = x.split(50);
+        Tree w = z.split(1050);
+        Tree first  = Tree::set_union(std::move(x), std::move(z));
+        Tree second = Tree::set_union(std::move(w), std::move(y));
+        EXPECT_EQ(first.size(), 100);
+        EXPECT_EQ(second.size(), 100);
+        EXPECT_EQ(second.begin()->first, 50);
+        EXPECT_GT(upstream.blocks, 0);
+    }
+    EXPECT_EQ(upstream.blocks, 0);
+}
+
+TEST(ThreadedBinaryTree, SetOperationsStdAllocator) {
+    using Tree = ThreadedBinaryTree<int, int, std::less<int>,
+                                    NoAggregate, AvlBalance, std::allocator<std::pair<const int, int>>>;
+    Tree a, b;
+    for (int i = 0; i < 50; ++i) {
+        a.insert(i, 0);
+        b.insert(i + 25, 1);
+    }
+
+    EXPECT_EQ(Tree::set_union(a, b).size(), 75);
+    EXPECT_EQ(Tree::set_intersection(a, b).size(), 25);
+    EXPECT_EQ(Tree::set_difference(b, a).begin()->first, 50);
+    EXPECT_EQ(a.size(), 50);
+}
+
+namespace {
+
+// Значение, считающее копирования и созданные объекты
+struct Tracked {
+    static inline int copies = 0;
+    static inline int constructed = 0;
+
+    Tracked() { ++constructed; }
+    Tracked(int a, int b) : value(a + b) { ++constructed; }
+    Tracked(const Tracked& other) : value(other.value) { ++copies; }
+    Tracked(Tracked&& other) noexcept : value(other.value) {}
+    Tracked& operator=(const Tracked& other) { value = other.value; ++copies; return *this; }
+    Tracked& operator=(Tracked&&) noexcept = default;
+
+    static void reset() { copies = 0; constructed = 0; }
+
+    int value = 0;
+};
+
+} // namespace
+
+TEST(ThreadedBinaryTree, EmplaceAndTryEmplace) {
+    ThreadedBinaryTree<std::string, Tracked> tree;
+    Tracked::reset();
+
+    auto [it, inserted] = tree.try_emplace("a", 1, 2);
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(it->second.value, 3);
+    EXPECT_EQ(Tracked::constructed, 1);
+
+    // Ключ уже есть: значение не создается
+    EXPECT_FALSE(tree.try_emplace("a", 5, 5).second);
+    EXPECT_EQ(Tracked::constructed, 1);
+    EXPECT_EQ(tree.at("a").value, 3);
+
+    std::string key = "b";
+    tree.emplace(std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                 std::forward_as_tuple(10, 20));
+    EXPECT_EQ(tree.at("b").value, 30);
+
+    tree.insert(std::pair<const std::string, Tracked>{"c", Tracked(1, 1)});
+    tree.emplace(std::string("d"), Tracked(2, 2));
+    EXPECT_EQ(Tracked::copies, 0);
+    EXPECT_EQ(tree.size(), 4);
+
+    EXPECT_FALSE(tree.emplace(std::string("d"), Tracked(7, 7)).second);
+    EXPECT_EQ(tree.at("d").value, 4);
+
+    tree["e"].value = 42;
+    EXPECT_EQ(tree.at("e").value, 42);
+    EXPECT_EQ(Tracked::copies, 0);
+}
+
+TEST(ThreadedBinaryTree, TryEmplaceKeepsMovedKeyOnFailure) {
+    ThreadedBinaryTree<std::string, int> tree;
+    tree.try_emplace("key", 1);
+
+    std::string key = "key";
+    EXPECT_FALSE(tree.try_emplace(std::move(key), 2).second);
+    EXPECT_EQ(key, "key");
+    EXPECT_EQ(tree.at("key"), 1);
+
+    std::string other = "other";
+    EXPECT_TRUE(tree.try_emplace(std::move(other), 3).second);
+    EXPECT_EQ(tree.at("other"), 3);
+}
+
+TEST(ThreadedBinaryTree, HintedInsert) {
+    ThreadedBinaryTree<int, int> tree;
+
+    // Возрастающий поток с hint = end()
+    for (int i = 0; i < 200; i += 2) {
+        auto it = tree.insert(tree.end(), i, i);
+        EXPECT_EQ(it->first, i);
+    }
+    EXPECT_EQ(tree.size(), 100);
+
+    // Подсказка рядом с местом вставки и совсем мимо
+    tree.insert(tree.find(10), 9, 9);
+    tree.insert(tree.find(10), 11, 11);
+    tree.insert(tree.begin(), -1, -1);
+    tree.insert(tree.find(150), 3, 3);
+    tree.insert(tree.end(), 1, 1);
+
+    // Существующий ключ не перезаписывается
+    auto it = tree.insert(tree.find(20), 20, -20);
+    EXPECT_EQ(it->second, 20);
+
+    EXPECT_EQ(tree.size(), 105);
+    EXPECT_EQ(tree.rank(12), 11);  // -1, 0, 1, 2, 3, 4, 6, 8, 9, 10, 11
+
+    int prev = -2;
+    for (const auto& [key, value] : tree) {
+        EXPECT_LT(prev, key);
+        EXPECT_EQ(key, value);
+        prev = key;
+    }
+    EXPECT_EQ(std::prev(tree.end())->first, 198);
+    EXPECT_EQ(tree.begin()->first, -1);
+}
+
+namespace {
+
+// Некоммутативный моноид: проверяет порядок свертки
+struct ConcatAggregate {
+    using result_type = std::string;
+
+    static result_type identity() { return {}; }
+
+    static result_type lift(const int&, const std::string& value) { return value; }
+
+    static result_type combine(const result_type& lhs, const result_type& rhs) { return lhs + rhs; }
+};
+
+} // namespace
+
+TEST(ThreadedBinaryTree, AggregateSumMax) {
+    using Agg  = PairAggregate<SumAggregate<long long>, MaxAggregate<int>>;
+    using Tree = ThreadedBinaryTree<int, int, std::less<int>, Agg>;
+
+    Tree tree;
+    std::map<int, int> reference;
+    for (int i = 0; i < 300; ++i) {
+        int key = (i * 37) % 301;
+        tree.insert(key, (key * 7) % 50 - 20);
+        reference.emplace(key, (key * 7) % 50 - 20);
+    }
+    for (int i = 0; i < 300; i += 4) {
+        tree.remove((i * 11) % 301);
+        reference.erase((i * 11) % 301);
+    }
+
+    auto check = [&](const Tree& t, const std::map<int, int>& ref) {
+        for (int lo = -3; lo < 305; lo += 17) {
+            for (int hi = lo - 1; hi < 305; hi += 23) {
+                long long sum = 0;
+                std::optional<int> max;
+                for (auto it = ref.lower_bound(lo); it != ref.end() && it->first <= hi; ++it) {
+                    sum += it->second;
+                    max = max ? std::max(*max, it->second) : it->second;
+                }
+                auto [tsum, tmax] = t.aggregate(lo, hi);
+                ASSERT_EQ(tsum, sum);
+                ASSERT_EQ(tmax, max);
+            }
+        }
+    };
+    check(tree, reference);
+
+    // Значение меняется только через update(): ссылки на значение константные
+    static_assert(std::is_const_v<std::remove_reference_t<decltype(tree.at(0))>>);
+    static_assert(std::is_const_v<std::remove_reference_t<decltype((tree.begin()->second))>>);
+    tree.update(tree.find(reference.begin()->first), 1000);
+    reference.begin()->second = 1000;
+    EXPECT_TRUE(tree.update(std::prev(reference.end())->first, -500));
+    std::prev(reference.end())->second = -500;
+    EXPECT_FALSE(tree.update(1000, 1));
+    check(tree, reference);
+
+    // Агрегаты переживают split/join
+    auto right = tree.split(150);
+    std::map<int, int> ref_right(reference.lower_bound(150), reference.end());
+    reference.erase(reference.lower_bound(150), reference.end());
+    check(tree, reference);
+    check(right, ref_right);
+}
+
+TEST(ThreadedBinaryTree, AggregateKeepsOrder) {
+    ThreadedBinaryTree<int, std::string, std::less<int>, ConcatAggregate> tree;
+    std::string letters = "abcdefghijklmnopqrstuvwxyz";
+    for (int i = 25; i >= 0; --i) {
+        tree.insert(i, std::string(1, letters[i]));
+    }
+
+    EXPECT_EQ(tree.aggregate(0, 25), letters);
+    EXPECT_EQ(tree.aggregate(3, 9), "defghij");
+    EXPECT_EQ(tree.aggregate(-10, 2), "abc");
+    EXPECT_EQ(tree.aggregate(9, 3), "");
+
+    tree.remove(5);
+    EXPECT_EQ(tree.aggregate(3, 9), "deghij");
+}
+
+TEST(ThreadedBinaryTree, FreezeSnapshot) {
+    ThreadedBinaryTree<int, int> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert((i * 7919) % 3000, i);
+    }
+
+    auto snapshot = tree.freeze();
+    ASSERT_EQ(snapshot.size(), tree.size());
+
+    for (int lo = -5; lo < 3005; lo += 13) {
+        auto expected_lower = std::distance(tree.begin(), tree.lower_bound(lo));
+        auto expected_upper = std::distance(tree.begin(), tree.upper_bound(lo));
+        ASSERT_EQ(snapshot.lower_bound(lo), static_cast<size_t>(expected_lower));
+        ASSERT_EQ(snapshot.upper_bound(lo), static_cast<size_t>(expected_upper));
+
+        for (int hi = lo - 1; hi < 3005; hi += 101) {
+            ASSERT_EQ(snapshot.count_range(lo, hi), tree.count_range(lo, hi));
+        }
+    }
+
+    auto it = tree.begin();
+    for (const auto& [key, value] : snapshot) {
+        EXPECT_EQ(key, it->first);
+        EXPECT_EQ(value, it->second);
+        ++it;
+    }
+
+    ASSERT_NE(snapshot.find(tree.begin()->first), nullptr);
+    EXPECT_EQ(*snapshot.find(tree.begin()->first), tree.begin()->second);
+    EXPECT_EQ(snapshot.find(-1), nullptr);
+
+    // Снимок не зависит от дальнейших изменений дерева
+    tree.insert(-1, -1);
+    EXPECT_EQ(snapshot.find(-1), nullptr);
+
+    ThreadedBinaryTree<int, int> empty;
+    auto empty_snapshot = empty.freeze();
+    EXPECT_EQ(empty_snapshot.lower_bound(5), 0);
+    EXPECT_EQ(empty_snapshot.count_range(0, 10), 0);
+}
+
+template<typename BalanceT>
+static void check_balance_policy() {
+    using Tree = ThreadedBinaryTree<int, int, std::less<int>, SumAggregate<long long>, BalanceT>;
+
+    std::vector<std::pair<int, int>> items;
+    for (int i = 0; i < 500; ++i) {
+        items.emplace_back(i * 3, i);
+    }
+    Tree tree = Tree::from_sorted(items.begin(), items.end());
+    std::map<int, int> expected(items.begin(), items.end());
+
+    std::mt19937 rng(7);
+    for (int i = 0; i < 4000; ++i) {
+        int key = static_cast<int>(rng() % 2000);
+        if (rng() % 2 == 0) {
+            ASSERT_EQ(tree.insert(key, key).second, expected.emplace(key, key).second);
+        } else {
+            ASSERT_EQ(tree.remove(key), expected.erase(key) == 1);
+        }
+    }
+
+    ASSERT_EQ(tree.size(), expected.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+
+    long long sum = 0;
+    for (const auto& [key, value] : expected) {
+        if (key >= 100 && key <= 1500) { sum += value; }
+    }
+    EXPECT_EQ(tree.aggregate(100, 1500), sum);
+    EXPECT_EQ(tree.count_range(100, 1500),
+              static_cast<size_t>(std::distance(expected.lower_bound(100), expected.upper_bound(1500))));
+
+    for (const auto& [key, value] : expected) {
+        ASSERT_TRUE(tree.remove(key));
+    }
+    EXPECT_TRUE(tree.empty());
+}
+
+TEST(ThreadedBinaryTree, BalancePolicies) {
+    check_balance_policy<AvlBalance>();
+    check_balance_policy<WavlBalance>();
+    check_balance_policy<RedBlackBalance>();
+}
+
+TEST(ThreadedBinaryTree, EraseIteratorAndRange) {
+    ThreadedBinaryTree<int, int, std::less<int>, SumAggregate<long long>> tree;
+    std::map<int, int> expected;
+    for (int i = 0; i < 2000; ++i) {
+        tree.insert(i * 2, i);
+        expected.emplace(i * 2, i);
+    }
+
+    // Возвращается итератор на следующий элемент
+    auto it = tree.erase(tree.find(10));
+    ASSERT_NE(it, tree.end());
+    EXPECT_EQ(it->first, 12);
+    expected.erase(10);
+
+    // Короткий диапазон удаляется поэлементно, длинный - через split/join
+    it = tree.erase(tree.find(20), tree.find(30));
+    EXPECT_EQ(it->first, 30);
+    expected.erase(expected.find(20), expected.find(30));
+
+    EXPECT_EQ(tree.erase_range(100, 2999), 1450);
+    expected.erase(expected.lower_bound(100), expected.upper_bound(2999));
+
+    EXPECT_EQ(tree.erase_range(3500, 10000), 250);
+    expected.erase(expected.lower_bound(3500), expected.end());
+
+    EXPECT_EQ(tree.erase_range(5, 4), 0);
+    EXPECT_EQ(tree.erase_range(1, 1), 0);
+
+    ASSERT_EQ(tree.size(), expected.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+    EXPECT_TRUE(std::equal(tree.crbegin(), tree.crend(), expected.rbegin(), expected.rend()));
+
+    long long sum = 0;
+    for (const auto& [key, value] : expected) { sum += value; }
+    EXPECT_EQ(tree.aggregate(0, 10000), sum);
+
+    tree.insert(3000, 0);
+    EXPECT_EQ(tree.index_of(tree.find(3000)), tree.rank(3000));
+
+    tree.erase(tree.begin(), tree.end());
+    EXPECT_TRUE(tree.empty());
+    EXPECT_EQ(tree.begin(), tree.end());
+}
+
+TEST(ThreadedBinaryTree, EraseRangeWithoutSplit) {
+    ThreadedBinaryTree<int, int, std::less<int>, NoAggregate, RedBlackBalance> tree;
+    for (int i = 0; i < 500; ++i) {
+        tree.insert(i, i);
+    }
+
+    EXPECT_EQ(tree.erase_range(100, 399), 300);
+    EXPECT_EQ(tree.size(), 200);
+    EXPECT_EQ(tree.nth(100)->first, 400);
+}
+
+template<typename TreeT>
+concept ViewLookup = requires(const TreeT& tree, std::string_view key) { tree.find(key); };
+
+TEST(ThreadedBinaryTree, TransparentLookup) {
+    ThreadedBinaryTree<std::string, int, std::less<>> tree;
+    for (const char* word : {"apple", "banana", "cherry", "date", "fig"}) {
+        tree.insert(word, static_cast<int>(std::string_view(word).size()));
+    }
+
+    std::string_view key = "cherry";
+    ASSERT_NE(tree.find(key), tree.end());
+    EXPECT_EQ(tree.find(key)->second, 6);
+    EXPECT_EQ(tree.find("grape"), tree.end());
+
+    EXPECT_EQ(tree.at(std::string_view("fig")), 3);
+    tree.at("date") = 40;
+    EXPECT_EQ(tree.at(std::string_view("date")), 40);
+    EXPECT_THROW(tree.at("kiwi"), std::out_of_range);
+
+    EXPECT_EQ(tree.lower_bound(std::string_view("c"))->first, "cherry");
+    EXPECT_EQ(tree.upper_bound(std::string_view("date"))->first, "fig");
+    EXPECT_EQ(tree.rank(std::string_view("d")), 3);
+    EXPECT_EQ(tree.count_range(std::string_view("b"), std::string_view("e")), 3);
+
+    // Без is_transparent гетерогенные перегрузки недоступны
+    static_assert(ViewLookup<decltype(tree)>);
+    static_assert(!ViewLookup<ThreadedBinaryTree<std::string, int>>);
+}
+
+TEST(ThreadedBinaryTree, FromUnsorted) {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> dist(0, 20'000);
+
+    // Больше PARALLEL_CUTOFF, чтобы сработали параллельные ветви
+    std::vector<std::pair<int, int>> items;
+    std::map<int, int> expected;
+    for (int i = 0; i < 50'000; ++i) {
+        int key = dist(gen);
+        items.emplace_back(key, i);
+        expected.emplace(key, i);
+    }
+
+    auto tree = ThreadedBinaryTree<int, int>::from_unsorted(items.begin(), items.end());
+    ASSERT_EQ(tree.size(), expected.size());
+    EXPECT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end(),
+                           [](const auto& a, const auto& b) { return a == b; }));
+
+    using RbTree = ThreadedBinaryTree<int, int, std::less<int>, NoAggregate, RedBlackBalance>;
+    auto rb = RbTree::from_unsorted(items);
+    EXPECT_EQ(rb.size(), expected.size());
+    EXPECT_EQ(rb.at(items.front().first), expected.at(items.front().first));
+
+    EXPECT_TRUE((ThreadedBinaryTree<int, int>::from_unsorted(items.end(), items.end()).empty()));
+}
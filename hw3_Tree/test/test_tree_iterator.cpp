@@ -2,6 +2,7 @@
 #include <iterator>
 #include <algorithm>
 #include <vector>
+#include <utility>
 
 #include <gtest/gtest.h>
 
@@ -315,3 +316,57 @@ TEST(ThreadedBinaryTree, IteratorBidirectionalTraversal) {
     EXPECT_EQ(it->first, 3);
     EXPECT_EQ(it, tree.begin());
 }
+
+TEST(ThreadedBinaryTree, NthAndIndexOf) {
+    ThreadedBinaryTree<int, int> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert((i * 7919) % 1000 * 2, i);
+    }
+
+    size_t index = 0;
+    for (auto it = tree.begin(); it != tree.end(); ++it, ++index) {
+        EXPECT_EQ(tree.nth(index), it);
+        EXPECT_EQ(tree.index_of(it), index);
+    }
+
+    EXPECT_EQ(tree.nth(tree.size()), tree.end());
+    EXPECT_EQ(tree.index_of(tree.end()), tree.size());
+
+    // Медиана
+    EXPECT_EQ(tree.nth(tree.size() / 2)->first, 1000);
+
+    // Номера пересчитываются после удаления
+    tree.remove(0);
+    tree.remove(1000);
+    EXPECT_EQ(tree.nth(0)->first, 2);
+    EXPECT_EQ(tree.index_of(tree.find(1002)), 499);
+
+    const auto& ctree = tree;
+    EXPECT_EQ(ctree.nth(ctree.size() - 1)->first, 1998);
+    EXPECT_EQ(ctree.index_of(ctree.find(1998)), ctree.size() - 1);
+
+    ThreadedBinaryTree<int, int> empty;
+    EXPECT_EQ(empty.nth(0), empty.end());
+    EXPECT_EQ(empty.index_of(empty.begin()), 0);
+}
+
+TEST(ThreadedBinaryTree, ForEachInRange) {
+    ThreadedBinaryTree<int, int> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.insert((i * 37) % 1000 * 3, i);
+    }
+
+    for (auto [lo, hi] : {std::pair{-5, 10}, {3, 3}, {4, 5}, {100, 2000}, {2990, 5000}, {10, 9}}) {
+        std::vector<int> expected;
+        for (auto it = tree.lower_bound(lo); it != tree.upper_bound(hi); ++it) {
+            expected.push_back(it->first);
+        }
+
+        std::vector<int> visited;
+        tree.for_each_in_range(lo, hi, [&](const auto& item) { visited.push_back(item.first); });
+        EXPECT_EQ(visited, expected) << "[" << lo << ", " << hi << "]";
+    }
+
+    ThreadedBinaryTree<int, int> empty;
+    empty.for_each_in_range(0, 100, [](const auto&) { FAIL(); });
+}
@@ -0,0 +1,134 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "tree.hpp"
+#include "versioned_tree.hpp"
+
+using namespace myds;
+
+using Versioned = VersionedTree<ThreadedBinaryTree<int, int>>;
+
+TEST(VersionedTree, ChangesVisibleAfterPublish) {
+    Versioned tree;
+    auto empty = tree.snapshot();
+
+    tree.insert(1, 10);
+    tree.insert(2, 20);
+    EXPECT_TRUE(tree.snapshot()->empty());
+
+    tree.publish();
+    auto first = tree.snapshot();
+    EXPECT_EQ(tree.version(), 1);
+    EXPECT_EQ(first->size(), 2);
+    EXPECT_EQ(first->at(2), 20);
+    EXPECT_TRUE(empty->empty());
+
+    EXPECT_FALSE(tree.insert(1, 11));
+    EXPECT_TRUE(tree.remove(1));
+    EXPECT_FALSE(tree.remove(5));
+    tree.insert(3, 30);
+    tree.publish();
+
+    // Старая версия не изменилась, пока ее держит читатель
+    EXPECT_EQ(first->size(), 2);
+    EXPECT_NE(first->find(1), first->end());
+
+    auto second = tree.snapshot();
+    EXPECT_EQ(second->size(), 2);
+    EXPECT_EQ(second->find(1), second->end());
+    EXPECT_EQ(second->at(3), 30);
+}
+
+TEST(VersionedTree, ReplayKeepsVersionsInSync) {
+    Versioned tree;
+
+    // Без удерживаемых снимков версии чередуются и догоняют друг друга по журналу
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 10; ++i) {
+            tree.insert(round * 10 + i, i);
+        }
+        tree.remove(round * 10);
+        tree.publish();
+
+        auto snapshot = tree.snapshot();
+        ASSERT_EQ(snapshot->size(), static_cast<size_t>((round + 1) * 9));
+        ASSERT_EQ(snapshot->count_range(0, round * 10 + 9), snapshot->size());
+    }
+}
+
+TEST(VersionedTree, HeldSpareDefersRestore) {
+    Versioned tree;
+    tree.insert(1, 10);
+    tree.publish();
+
+    // Пока читают снятую с публикации версию, рабочей копии нет:
+    // ответы insert/remove берутся из текущей версии и журнала
+    auto held = tree.snapshot();
+    tree.insert(2, 20);
+    tree.publish();
+
+    EXPECT_FALSE(tree.insert(1, 11));
+    EXPECT_TRUE(tree.remove(2));
+    EXPECT_FALSE(tree.remove(2));
+    EXPECT_TRUE(tree.insert(2, 21));
+    EXPECT_TRUE(tree.insert(3, 30));
+
+    held.reset();
+    EXPECT_TRUE(tree.insert(4, 40));
+    tree.publish();
+
+    auto latest = tree.snapshot();
+    ASSERT_EQ(latest->size(), 4);
+    EXPECT_EQ(latest->at(1), 10);
+    EXPECT_EQ(latest->at(2), 21);
+    EXPECT_EQ(latest->at(4), 40);
+
+    // Снимок, удерживаемый две публикации подряд, вынуждает копию - результат тот же
+    auto old = tree.snapshot();
+    tree.insert(5, 50);
+    tree.publish();
+    tree.remove(1);
+    tree.publish();
+
+    EXPECT_EQ(old->size(), 4);
+    latest = tree.snapshot();
+    EXPECT_EQ(latest->size(), 4);
+    EXPECT_EQ(latest->find(1), latest->end());
+    EXPECT_EQ(latest->at(5), 50);
+}
+
+TEST(VersionedTree, ConcurrentReaders) {
+    Versioned tree;
+    std::atomic<bool> done{false};
+    std::atomic<bool> consistent{true};
+
+    // Писатель дописывает ключи по порядку, поэтому любая версия - это 0..n-1
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                auto snapshot = tree.snapshot();
+                int expected = 0;
+                for (const auto& [key, value] : *snapshot) {
+                    if (key != expected || value != -key) { consistent = false; }
+                    ++expected;
+                }
+                if (static_cast<size_t>(expected) != snapshot->size()) { consistent = false; }
+                if (snapshot->count_range(0, expected) != snapshot->size()) { consistent = false; }
+            }
+        });
+    }
+
+    for (int i = 0; i < 500; ++i) {
+        tree.insert(i, -i);
+        if (i % 25 == 24) { tree.publish(); }
+    }
+    done = true;
+    for (auto& reader : readers) { reader.join(); }
+
+    EXPECT_TRUE(consistent.load());
+    EXPECT_EQ(tree.snapshot()->size(), 500);
+}